@@ -0,0 +1,163 @@
+/*
+    chashbench.cpp
+
+    multi-threaded benchmark for ConcurrentHashTable
+
+    Each run fills a table with half of a key space of ipNumbers, then
+    starts T threads which together perform the given number of
+    operations on random keys of the space: the given percentage are
+    Retrieve, and the rest are split evenly between Insert and Remove,
+    so the table stays about half full. T runs through 1, 2, 4, ... up
+    to the given maximum (default 16).
+
+    Two tables are measured:
+
+       striped    ConcurrentHashTable <ipNumber, int, ipFmixHash>
+       mutex      HashTable <ipNumber, int, ipFmixHash, PowerOfTwoBuckets>
+                  behind one std::mutex, the baseline
+
+    For each: wall time, millions of operations per second, and the
+    speedup over the same table with one thread.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+
+#include <hashtbl.h>
+#include <chashtbl.h>
+#include <iphash.h>
+
+typedef fsu::ConcurrentHashTable < ipNumber, int, ipFmixHash >                   StripedTable;
+typedef fsu::HashTable < ipNumber, int, ipFmixHash, fsu::PowerOfTwoBuckets >    PlainTable;
+
+class MutexTable
+// PlainTable with every operation under one lock
+{
+public:
+  bool Insert (ipNumber k, int d)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    table_.Insert(k, d);
+    return 1;
+  }
+  bool Remove (ipNumber k)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return table_.Remove(k);
+  }
+  bool Retrieve (ipNumber k, int& d) const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return table_.Retrieve(k, d);
+  }
+  explicit MutexTable (size_t numBuckets) : table_(numBuckets) {}
+private:
+  PlainTable          table_;
+  mutable std::mutex  mutex_;
+} ;
+
+static uint32_t XorShift (uint32_t& state)
+{
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static ipNumber Key (uint32_t r)
+// spread the key space over addresses the way a route table would
+{
+  return (r << 8) | 0x0A000001;
+}
+
+template < class T >
+void Work (T* table, size_t numKeys, size_t ops, unsigned readPercent,
+           uint32_t seed, size_t* found)
+{
+  uint32_t state = seed;
+  size_t f = 0;
+  int d;
+  for (size_t i = 0; i < ops; ++i)
+  {
+    ipNumber k = Key(XorShift(state) % numKeys);
+    // a draw of its own, scaled to 0..99 without the bias of a modulus
+    unsigned op = (unsigned)((uint64_t)XorShift(state) * 100 >> 32);
+    if (op < readPercent)
+      f += table->Retrieve(k, d);
+    else if (op & 1)
+      table->Insert(k, (int)i);
+    else
+      table->Remove(k);
+  }
+  *found = f;
+}
+
+template < class T >
+double Run (size_t numKeys, size_t ops, unsigned readPercent, unsigned threads)
+// seconds for ops operations shared by threads
+{
+  T table(numKeys);
+  for (size_t i = 0; i < numKeys; i += 2)
+    table.Insert(Key((uint32_t)i), (int)i);
+
+  std::vector < std::thread > pool;
+  std::vector < size_t > found(threads, 0);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; ++t)
+    pool.push_back(std::thread(Work<T>, &table, numKeys, ops / threads, readPercent,
+                               2463534242u + 7919u * t, &found[t]));
+  for (unsigned t = 0; t < threads; ++t)
+    pool[t].join();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template < class T >
+void Series (const char* name, size_t numKeys, size_t ops, unsigned readPercent, unsigned maxThreads)
+{
+  double one = 0;
+  for (unsigned threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    double seconds = Run<T>(numKeys, ops, readPercent, threads);
+    if (threads == 1) one = seconds;
+    std::cout << "  " << std::left << std::setw(10) << name << std::right
+              << std::setw(8) << threads
+              << std::setw(12) << seconds
+              << std::setw(12) << ops / seconds / 1e6
+              << std::setw(10) << one / seconds << '\n';
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 4 || argc > 5)
+  {
+    std::cout << " ** program requires 3 or 4 arguments\n"
+	      << "    1 = number of keys in the key space (required)\n"
+	      << "    2 = number of operations per run (required)\n"
+	      << "    3 = percent of operations that are Retrieve (required)\n"
+	      << "    4 = max number of threads, default 16 (optional)\n"
+	      << " ** try again\n";
+    exit(0);
+  }
+  size_t numKeys = atol(argv[1]), ops = atol(argv[2]);
+  unsigned readPercent = atoi(argv[3]), maxThreads = (argc == 5) ? atoi(argv[4]) : 16;
+  if (numKeys == 0 || ops == 0 || readPercent > 100 || maxThreads == 0)
+  {
+    std::cout << " ** arguments out of range\n"
+	      << " ** program closing\n";
+    exit(0);
+  }
+
+  std::cout << "keys " << numKeys << ", ops " << ops << ", reads " << readPercent
+            << "%, " << std::thread::hardware_concurrency() << " hardware threads\n"
+            << "  table      threads     seconds      Mops/s   speedup\n"
+            << std::fixed << std::setprecision(3);
+  Series<StripedTable>("striped", numKeys, ops, readPercent, maxThreads);
+  Series<MutexTable>("mutex", numKeys, ops, readPercent, maxThreads);
+  return 0;
+}
@@ -0,0 +1,520 @@
+/*
+    chashtbl.h
+
+    Defining the classes StripeLock
+                     and ConcurrentHashTable <K, D, H>
+
+    A HashTable <K, D, H> that many threads may use at once. The layout
+    is the same: a vector of buckets, each a HashChain < Entry <K,D> >
+    (see hashnode.h) of nodes from global new. The buckets are divided
+    among numStripes stripes, each guarded by its own StripeLock, so
+    operations on keys of different stripes do not wait for each other,
+    and readers of the same stripe do not wait at all.
+
+    K                    = KeyType
+    D                    = DataType
+    Entry < K , D >      = EntryType
+    H                    = HashType
+    HashChain < EntryType > = BucketType
+
+    The bucket count is a power of two and a key's bucket is
+    Finalize(hash) & (buckets - 1) (see hashpolicy.h). Its stripe is the
+    low bits of the same value, Finalize(hash) & (stripes - 1); there are
+    never more stripes than buckets, so a stripe is the set of buckets
+    whose index is congruent to it, and a key keeps its stripe when the
+    table grows.
+
+    StripeLock is a reader-writer spin lock in one atomic word: the high
+    bit marks a writer, the rest count readers. A reader adds one and is
+    done unless a writer holds the bit, so an uncontended Retrieve costs
+    one atomic add in and one out. A writer sets the bit, which turns
+    away new readers, and waits for the readers already in to leave.
+    Each lock shares a cache line only with its stripe's entry count:
+    Stripe is alignas(64), and the stripe array is carved from a buffer
+    aligned by hand, since new[] of an over-aligned type does not align
+    it before C++17.
+
+    The read side is a lock rather than a seqlock because a reader walks
+    list nodes that a concurrent Remove may free; a seqlock reader would
+    have to be able to read freed memory and retry.
+
+    Operations return copies instead of iterators, which would outlive
+    the lock. Get returns the data by value, inserting D() first if k is
+    not in the table; Put is Insert. There is no iteration.
+
+    Growth: when an Insert leaves its stripe with more than maxLoad
+    entries per bucket, it releases the stripe, takes every stripe in
+    order, and, unless another thread has already done so, doubles the
+    buckets, relinking the nodes into the new ones without allocating.
+    Every other operation waits while the entries are moved, so a table
+    sized for its load up front avoids the pauses; SetMaxLoad(0) turns
+    growth off. Clear and Rehash also take every stripe.
+
+    Size() adds the stripe counts without locking them, so while other
+    threads update the table it is only a snapshot.
+*/
+
+#ifndef _CHASHTBL_H
+#define _CHASHTBL_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <new>
+#include <atomic>
+#include <thread>
+
+#include <entry.h>
+#include <vector.h>
+#include <hashpolicy.h>
+#include <hashnode.h>
+
+namespace fsu
+{
+
+  //--------------------------------------------
+  //     StripeLock
+  //--------------------------------------------
+
+  class StripeLock
+  {
+  public:
+    void  LockShared    ();
+    void  UnlockShared  ();
+    void  Lock          ();
+    void  Unlock        ();
+
+    StripeLock () : state_(0) {}
+
+  private:
+    static const uint32_t writer = 0x80000000u;
+    static void Pause (unsigned& spins);
+
+    std::atomic < uint32_t > state_;
+
+    // prevent copying - do not implement
+    StripeLock              (const StripeLock&);
+    StripeLock& operator =  (const StripeLock&);
+  } ;
+
+  inline void StripeLock::Pause (unsigned& spins)
+  {
+    if (++spins < 64)
+    {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+      __builtin_ia32_pause();
+#endif
+    }
+    else
+    {
+      std::this_thread::yield();
+      spins = 0;
+    }
+  }
+
+  inline void StripeLock::LockShared ()
+  {
+    unsigned spins = 0;
+    while (state_.fetch_add(1, std::memory_order_acquire) & writer)
+    {
+      state_.fetch_sub(1, std::memory_order_relaxed);
+      while (state_.load(std::memory_order_relaxed) & writer)
+        Pause(spins);
+    }
+  }
+
+  inline void StripeLock::UnlockShared ()
+  {
+    state_.fetch_sub(1, std::memory_order_release);
+  }
+
+  inline void StripeLock::Lock ()
+  {
+    unsigned spins = 0;
+    while (state_.fetch_or(writer, std::memory_order_acquire) & writer)
+      while (state_.load(std::memory_order_relaxed) & writer)
+        Pause(spins);
+    // new readers back off now; wait for the ones already in
+    while (state_.load(std::memory_order_acquire) != writer)
+      Pause(spins);
+  }
+
+  inline void StripeLock::Unlock ()
+  {
+    state_.fetch_and(~writer, std::memory_order_release);
+  }
+
+  //--------------------------------------------
+  //     ConcurrentHashTable <K,D,H>
+  //--------------------------------------------
+
+  template <typename K, typename D, class H>
+  class ConcurrentHashTable
+  {
+  public:
+    typedef K                                KeyType;
+    typedef D                                DataType;
+    typedef fsu::Entry<K,D>                  EntryType;
+    typedef fsu::HashChain<EntryType>        BucketType;
+    typedef H                                HashType;
+    typedef typename BucketType::ValueType   ValueType;
+
+    // ADT Table
+    bool           Insert        (const K& k, const D& d);  // true if k was not in the table
+    bool           Remove        (const K& k);
+    bool           Retrieve      (const K& k, D& d) const;
+    bool           Includes      (const K& k) const;
+
+    // ADT Associative Array
+    D              Get           (const K& key);
+    void           Put           (const K& key, const D& data);
+
+    void           Clear         ();
+    void           Rehash        (size_t numBuckets = 0);   // default: one bucket per entry
+    size_t         Size          () const;
+    bool           Empty         () const;
+    size_t         NumBuckets    () const;
+    size_t         NumStripes    () const;
+
+    // Automatic doubling once Size() exceeds maxLoad per bucket, checked
+    // per stripe; on by default at 1.0, maxLoad 0 turns it off
+    void           SetMaxLoad    (double maxLoad);
+    size_t         ResizeCount   () const;
+
+    // first ctor uses default hash object, second uses supplied hash object;
+    // both counts are rounded up to powers of 2, stripes to at most buckets
+    explicit       ConcurrentHashTable (size_t numBuckets, size_t numStripes = defaultStripes);
+    ConcurrentHashTable (size_t numBuckets, HashType hashObject, size_t numStripes = defaultStripes);
+                   ~ConcurrentHashTable ();
+
+    static const size_t defaultStripes = 256;
+
+  private:
+    static const size_t lineSize = 64;
+
+    struct alignas(64) Stripe
+    {
+      StripeLock               lock_;
+      std::atomic < size_t >   size_;   // entries in the stripe's buckets, changed under lock_
+
+      Stripe () : size_(0) {}
+    } ;
+
+    // data
+    size_t                 numBuckets_;   // changed only with every stripe locked
+    Vector < BucketType >  bucketVector_;
+    HashType               hashObject_;
+    size_t                 numStripes_;
+    Stripe*                stripes_;      // numStripes_, line aligned, in stripeMemory_
+    void*                  stripeMemory_;
+    std::atomic < double > maxLoad_;
+    std::atomic < size_t > resizeCount_;
+
+    typedef typename BucketType::Node  Node;
+
+    uint64_t  Hash          (const KeyType& k) const;   // Finalize(hashObject_(k))
+    Stripe&   StripeOf      (uint64_t h) const;
+    void      Init          (size_t numBuckets, size_t numStripes);
+    void      LockAll       () const;
+    void      UnlockAll     () const;
+    void      Redistribute  (size_t numBuckets);      // every stripe locked
+    void      Grow          (size_t numBuckets);      // double, unless no longer numBuckets
+
+    // prevent copying - do not implement
+    ConcurrentHashTable              (const ConcurrentHashTable&);
+    ConcurrentHashTable& operator =  (const ConcurrentHashTable&);
+  } ;
+
+  //--------------------------------------------
+  //     ConcurrentHashTable <K,D,H>:: Implementations
+  //--------------------------------------------
+
+  template <typename K, typename D, class H>
+  ConcurrentHashTable<K,D,H>::ConcurrentHashTable (size_t numBuckets, size_t numStripes)
+    : numBuckets_(0), bucketVector_(0), hashObject_(), numStripes_(0), stripes_(0), stripeMemory_(0),
+      maxLoad_(1.0), resizeCount_(0)
+  {
+    Init(numBuckets, numStripes);
+  }
+
+  template <typename K, typename D, class H>
+  ConcurrentHashTable<K,D,H>::ConcurrentHashTable (size_t numBuckets, HashType hashObject, size_t numStripes)
+    : numBuckets_(0), bucketVector_(0), hashObject_(hashObject), numStripes_(0), stripes_(0), stripeMemory_(0),
+      maxLoad_(1.0), resizeCount_(0)
+  {
+    Init(numBuckets, numStripes);
+  }
+
+  template <typename K, typename D, class H>
+  ConcurrentHashTable<K,D,H>::~ConcurrentHashTable ()
+  {
+    Clear();
+    for (size_t s = 0; s < numStripes_; ++s)
+      stripes_[s].~Stripe();
+    ::operator delete(stripeMemory_);
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::Init (size_t numBuckets, size_t numStripes)
+  {
+    numStripes_ = PowerOfTwoBuckets::Buckets(numStripes, 0);
+    numBuckets_ = PowerOfTwoBuckets::Buckets(numBuckets, 0);
+    if (numBuckets_ < numStripes_)
+      numBuckets_ = numStripes_;
+    bucketVector_.SetSize(numBuckets_);
+    stripeMemory_ = ::operator new(numStripes_ * sizeof(Stripe) + lineSize - 1);
+    stripes_ = reinterpret_cast<Stripe*>(((uintptr_t)stripeMemory_ + lineSize - 1) & ~(uintptr_t)(lineSize - 1));
+    for (size_t s = 0; s < numStripes_; ++s)
+      new (&stripes_[s]) Stripe;
+  }
+
+  template <typename K, typename D, class H>
+  uint64_t ConcurrentHashTable<K,D,H>::Hash (const KeyType& k) const
+  {
+    return Finalize((uint64_t)hashObject_(k));
+  }
+
+  template <typename K, typename D, class H>
+  typename ConcurrentHashTable<K,D,H>::Stripe& ConcurrentHashTable<K,D,H>::StripeOf (uint64_t h) const
+  {
+    return stripes_[(size_t)h & (numStripes_ - 1)];
+  }
+
+  template <typename K, typename D, class H>
+  bool ConcurrentHashTable<K,D,H>::Insert (const K& k, const D& d)
+  {
+    uint64_t h = Hash(k);
+    Stripe& stripe = StripeOf(h);
+    size_t nb;
+    bool isNew = 0, grow = 0;
+
+    stripe.lock_.Lock();
+    nb = numBuckets_;
+    BucketType& bucket = bucketVector_[(size_t)h & (nb - 1)];
+    Node** link = bucket.Find(k);
+    if (*link == 0)
+    {
+      bucket.PushFront(new Node(EntryType(k, d)));
+      isNew = 1;
+      double maxLoad = maxLoad_.load(std::memory_order_relaxed);
+      size_t size = stripe.size_.load(std::memory_order_relaxed) + 1;
+      stripe.size_.store(size, std::memory_order_relaxed);
+      grow = maxLoad > 0 && size > maxLoad * (nb / numStripes_);
+    }
+    else
+      (*link)->value_.data_ = d;
+    stripe.lock_.Unlock();
+
+    if (grow)
+      Grow(nb);
+    return isNew;
+  }
+
+  template <typename K, typename D, class H>
+  bool ConcurrentHashTable<K,D,H>::Remove (const K& k)
+  {
+    uint64_t h = Hash(k);
+    Stripe& stripe = StripeOf(h);
+    bool found = 0;
+
+    stripe.lock_.Lock();
+    BucketType& bucket = bucketVector_[(size_t)h & (numBuckets_ - 1)];
+    Node** link = bucket.Find(k);
+    if (*link != 0)
+    {
+      delete bucket.Unlink(link);
+      stripe.size_.store(stripe.size_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+      found = 1;
+    }
+    stripe.lock_.Unlock();
+    return found;
+  }
+
+  template <typename K, typename D, class H>
+  bool ConcurrentHashTable<K,D,H>::Retrieve (const K& k, D& d) const
+  {
+    uint64_t h = Hash(k);
+    Stripe& stripe = StripeOf(h);
+    bool found = 0;
+
+    stripe.lock_.LockShared();
+    const BucketType& bucket = bucketVector_[(size_t)h & (numBuckets_ - 1)];
+    typename BucketType::ConstIterator i = bucket.Includes(k);
+    if (i != bucket.End())
+    {
+      d = (*i).data_;
+      found = 1;
+    }
+    stripe.lock_.UnlockShared();
+    return found;
+  }
+
+  template <typename K, typename D, class H>
+  bool ConcurrentHashTable<K,D,H>::Includes (const K& k) const
+  {
+    uint64_t h = Hash(k);
+    Stripe& stripe = StripeOf(h);
+
+    stripe.lock_.LockShared();
+    const BucketType& bucket = bucketVector_[(size_t)h & (numBuckets_ - 1)];
+    bool found = bucket.Includes(k) != bucket.End();
+    stripe.lock_.UnlockShared();
+    return found;
+  }
+
+  template <typename K, typename D, class H>
+  D ConcurrentHashTable<K,D,H>::Get (const K& k)
+  {
+    D d = D();
+    uint64_t h = Hash(k);
+    Stripe& stripe = StripeOf(h);
+    size_t nb;
+    bool grow = 0;
+
+    stripe.lock_.Lock();
+    nb = numBuckets_;
+    BucketType& bucket = bucketVector_[(size_t)h & (nb - 1)];
+    Node** link = bucket.Find(k);
+    if (*link == 0)
+    {
+      bucket.PushFront(new Node(EntryType(k)));
+      double maxLoad = maxLoad_.load(std::memory_order_relaxed);
+      size_t size = stripe.size_.load(std::memory_order_relaxed) + 1;
+      stripe.size_.store(size, std::memory_order_relaxed);
+      grow = maxLoad > 0 && size > maxLoad * (nb / numStripes_);
+    }
+    else
+      d = (*link)->value_.data_;
+    stripe.lock_.Unlock();
+
+    if (grow)
+      Grow(nb);
+    return d;
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::Put (const K& k, const D& d)
+  {
+    Insert(k, d);
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::LockAll () const
+  {
+    // always in stripe order, and never while holding a stripe
+    for (size_t s = 0; s < numStripes_; ++s)
+      stripes_[s].lock_.Lock();
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::UnlockAll () const
+  {
+    for (size_t s = numStripes_; s > 0; --s)
+      stripes_[s - 1].lock_.Unlock();
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::Redistribute (size_t nb)
+  {
+    Vector < BucketType > old(0);
+    old.Swap(bucketVector_);
+    numBuckets_ = nb;
+    bucketVector_.SetSize(numBuckets_);
+    Node *node, *next;
+    for (size_t b = 0; b < old.Size(); ++b)
+      // relink; keys are distinct, so no Find search
+      for (node = old[b].Release(); node != 0; node = next)
+      {
+        next = node->next_;
+        bucketVector_[(size_t)Hash(node->value_.key_) & (numBuckets_ - 1)].PushFront(node);
+      }
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::Grow (size_t nb)
+  {
+    LockAll();
+    if (numBuckets_ == nb)
+    {
+      Redistribute(2 * nb);
+      resizeCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    UnlockAll();
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::Rehash (size_t nb)
+  {
+    LockAll();
+    if (nb == 0)
+      for (size_t s = 0; s < numStripes_; ++s)
+        nb += stripes_[s].size_.load(std::memory_order_relaxed);
+    nb = PowerOfTwoBuckets::Buckets(nb, 0);
+    if (nb < numStripes_)
+      nb = numStripes_;
+    if (nb != numBuckets_)
+      Redistribute(nb);
+    UnlockAll();
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::Clear ()
+  {
+    LockAll();
+    Node *node, *next;
+    for (size_t b = 0; b < numBuckets_; ++b)
+      for (node = bucketVector_[b].Release(); node != 0; node = next)
+      {
+        next = node->next_;
+        delete node;
+      }
+    for (size_t s = 0; s < numStripes_; ++s)
+      stripes_[s].size_.store(0, std::memory_order_relaxed);
+    UnlockAll();
+  }
+
+  template <typename K, typename D, class H>
+  size_t ConcurrentHashTable<K,D,H>::Size () const
+  {
+    size_t size = 0;
+    for (size_t s = 0; s < numStripes_; ++s)
+      size += stripes_[s].size_.load(std::memory_order_relaxed);
+    return size;
+  }
+
+  template <typename K, typename D, class H>
+  bool ConcurrentHashTable<K,D,H>::Empty () const
+  {
+    return Size() == 0;
+  }
+
+  template <typename K, typename D, class H>
+  size_t ConcurrentHashTable<K,D,H>::NumBuckets () const
+  {
+    // the count changes only under every stripe's lock, so one will do
+    stripes_[0].lock_.LockShared();
+    size_t nb = numBuckets_;
+    stripes_[0].lock_.UnlockShared();
+    return nb;
+  }
+
+  template <typename K, typename D, class H>
+  size_t ConcurrentHashTable<K,D,H>::NumStripes () const
+  {
+    return numStripes_;
+  }
+
+  template <typename K, typename D, class H>
+  void ConcurrentHashTable<K,D,H>::SetMaxLoad (double maxLoad)
+  {
+    maxLoad_.store(maxLoad < 0 ? 0 : maxLoad, std::memory_order_relaxed);
+  }
+
+  template <typename K, typename D, class H>
+  size_t ConcurrentHashTable<K,D,H>::ResizeCount () const
+  {
+    return resizeCount_.load(std::memory_order_relaxed);
+  }
+
+} // namespace fsu
+
+#endif
@@ -319,14 +319,13 @@ int main(int argc, char* argv[])
     case 's': case 'S':
       if (BATCH) std::cout << '\n';
       std::cout << "  table size:      " << tablePtr->Size() << '\n';
-      // std::cout << "  max bucket size: " << tablePtr->MaxBucketSize() << '\n';
+      std::cout << "  max bucket size: " << tablePtr->MaxBucketSize() << '\n';
       break;
 
-    /*
     case 'a': case 'A':
+      if (BATCH) std::cout << '\n';
       tablePtr->Analysis(std::cout);
       break;
-    */
 
     case 'c': case 'C':
       if (BATCH) std::cout << '\n';
@@ -386,7 +385,7 @@ void DisplayMenu(std::ostream& os)
      << " x.Clear()  .........................  C\n"
      << " x.Rehash(numBuckets)  ..............  H numBuckets\n"
      << " x.Size()  ..........................  S\n"
-     // << " x.Analysis()  ......................  A\n"
+     << " x.Analysis()  ......................  A\n"
      << " x.Empty()  .........................  E\n"
      << " x.Dump(filename)  ..................  D\n"
      << " os << x  ...........................  O\n"
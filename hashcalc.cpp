@@ -6,16 +6,96 @@
     hash function calculator
 
     Copyright 2011, R. C. Lacher
+
+    hashcalc      string hashes Simple, MM, KISS
+    hashcalc ip   ipNumber hashes from iphash.h, entered in hex, and a
+                  timing of each, one key at a time and in batches
 */
 
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <xstring.cpp>
 #include <hashfunctions.cpp>
+#include <iphash.h>
+
+template < class H >
+void TimeHash (const char* name, const ipNumber* keys, size_t* hashes, size_t n, size_t reps)
+{
+  H h;
+  size_t sum = 0;
+  std::clock_t start = std::clock();
+  for (size_t r = 0; r < reps; ++r)
+    for (size_t i = 0; i < n; ++i)
+      sum += h(keys[i]);
+  double single = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+  start = std::clock();
+  for (size_t r = 0; r < reps; ++r)
+  {
+    HashBatch(h, keys, hashes, n);
+    sum += hashes[r % n];
+  }
+  double batch = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+  std::cout << "  " << std::setw(12) << name
+            << std::setw(12) << 1e9 * single / (n * reps) << " ns"
+            << std::setw(12) << 1e9 * batch / (n * reps) << " ns"
+            << "   (" << (sum & 1) << ")\n";
+}
+
+int IpMode ()
+{
+  ipNumber k;
+  unsigned int d;
+  std::cout << "Enter divisor for hash value          D: ";
+  std::cin >> d;
+  std::cout << "\nEnter ipNumber (hex) to be hashed (0 to quit): ";
+  std::cin >> std::hex >> k;
 
-int main()
+  ipMultHash mult;
+  ipFmixHash fmix;
+  ipCrcHash  crc;
+  while (std::cin && k != 0)
+  {
+    std::cout << std::dec
+              << "                        MultShift(k):       " << mult(k) << '\n'
+              << "                        MultShift(k) mod D: " << mult(k) % d << '\n'
+              << "                        Fmix32(k):          " << fmix(k) << '\n'
+              << "                        Fmix32(k) mod D:    " << fmix(k) % d << '\n'
+              << "                        CRC32C(k):          " << crc(k) << '\n'
+              << "                        CRC32C(k) mod D:    " << crc(k) % d << '\n'
+              << "\nEnter ipNumber (hex) to be hashed (0 to quit): ";
+    std::cin >> std::hex >> k;
+  }
+
+  // timing: the same block of pseudo-random addresses for each function
+  const size_t n = 4096, reps = 4096;
+  ipNumber * keys = new ipNumber [n];
+  size_t * hashes = new size_t [n];
+  uint32_t x = 2463534242u;
+  for (size_t i = 0; i < n; ++i)
+  {
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    keys[i] = x;
+  }
+  std::cout << std::dec << std::fixed << std::setprecision(3)
+            << "\n  " << std::setw(12) << "hash" << std::setw(15) << "per key"
+            << std::setw(15) << "batch" << '\n';
+  TimeHash < ipMultHash > ("MultShift", keys, hashes, n, reps);
+  TimeHash < ipFmixHash > ("Fmix32", keys, hashes, n, reps);
+  TimeHash < ipCrcHash >  ("CRC32C", keys, hashes, n, reps);
+  delete [] keys;
+  delete [] hashes;
+  return 0;
+}
+
+int main(int argc, char* argv[])
 {
+  if (argc > 1 && std::strcmp(argv[1], "ip") == 0)
+    return IpMode();
+
   fsu::String s;
   unsigned int d;
   std::cout << "Enter divisor for hash value          D: ";
@@ -6,15 +6,37 @@
 
     analysis test for hash tables
 
-    THashTable <K,D,H>
+    Benchmarks every hash class against every table backend:
 
-       K =      String
-       D =      int
-       H =      THash<K>
+       hash     Simple, MM, KISS                 on the String keys of the file
+                KISS, MultShift, Fmix32, CRC32C  on ipNumber keys
+       table    HashTable <K,D,H,PrimeBuckets>
+                HashTable <K,D,H,PowerOfTwoBuckets>
+                HashTable <K,D,H,FastRangeBuckets>
+                OHashTable <K,D,H>
+
+    The ipNumber keys are the file's keys when they are all hex numbers
+    (a route table file); otherwise the same number of addresses filling
+    consecutive /24 subnets, 200 hosts each, which is hard on weak hashes.
+
+    For each combination: ns per Insert, Retrieve (all hits) and Remove,
+    mean non-empty chain, max bucket size, chi-square / (buckets - 1) of
+    the bucket sizes (about 1 for a uniform hash), bytes per entry, and
+    the chain length histogram. For OHashTable a "bucket" is the set of
+    entries sharing a home slot. The chained tables get the given number
+    of buckets, the open table room for that many entries or for all the
+    keys if there are more, and none is resized during the run.
+
+    Results go to standard output as a table and, optionally, to a file
+    as CSV ("-" for standard output).
 */
 
 #include <fstream>
+#include <sstream>
+#include <string>
+#include <iomanip>
 #include <cctype>
+#include <ctime>
 
 #include <xstring.h>
 #include <hashclasses.h>
@@ -22,6 +44,8 @@
 #include <bitvect.h>
 
 #include <hashtbl.h>
+#include <ohashtbl.h>
+#include <iphash.h>
 
 /* // in lieu of makefile
 #include <xstring.cpp>
@@ -30,42 +54,138 @@
 #include <bitvect.cpp>
 // */
 
-// KISS hash function
 typedef fsu::String                         KeyType;
 typedef int                                 DataType;
-typedef hashclass::KISS < KeyType >         HashType;
-typedef fsu::Entry < KeyType, DataType >    EntryType;
-const bool prime = 1;
-// */
 
-/* // MM hash function
-typedef fsu::String                         KeyType;
-typedef int                                 DataType;
-typedef hashclass::MM < KeyType >           HashType;
-typedef fsu::Entry < KeyType, DataType >    EntryType;
-const bool prime = 1;
-// */
+struct Result
+{
+  std::string  hash_;
+  std::string  table_;
+  size_t       entries_;
+  size_t       buckets_;
+  double       insertNs_;
+  double       lookupNs_;
+  double       removeNs_;
+  double       meanChain_;
+  size_t       maxBucket_;
+  double       chiSquare_;
+  double       bytesPerEntry_;
+  std::string  histogram_;   // "length:buckets" pairs, ';' separated
+} ;
 
-/* // Simple hash function
-typedef fsu::String                         KeyType;
-typedef int                                 DataType;
-typedef hashclass::Simple < KeyType >       HashType;
-typedef fsu::Entry < KeyType, DataType >    EntryType;
-const bool prime = 0;
-// */
+static double NsPerOp (std::clock_t start, size_t ops)
+{
+  return ops ? 1e9 * (double)(std::clock() - start) / CLOCKS_PER_SEC / ops : 0.0;
+}
+
+template < class T >
+void BucketStats (const T& table, Result& r)
+// chain length histogram, max bucket, chi-square, from the bucket sizes
+{
+  fsu::Vector < size_t > count(0);
+  size_t b, len, nonEmpty = 0;
+  double expected = (double)table.Size() / table.NumBuckets(), chi = 0;
+  for (b = 0; b < table.NumBuckets(); ++b)
+  {
+    len = table.BucketSize(b);
+    while (count.Size() <= len)
+      count.PushBack(0);
+    ++count[len];
+    if (len > 0) ++nonEmpty;
+    chi += (len - expected) * (len - expected);
+  }
+  r.maxBucket_ = count.Size() - 1;
+  r.meanChain_ = nonEmpty ? (double)table.Size() / nonEmpty : 0.0;
+  r.chiSquare_ = (expected > 0 && table.NumBuckets() > 1)
+               ? chi / expected / (table.NumBuckets() - 1) : 0.0;
+  std::ostringstream os;
+  for (len = 0; len < count.Size(); ++len)
+    if (count[len] > 0)
+      os << (os.tellp() > 0 ? ";" : "") << len << ':' << count[len];
+  r.histogram_ = os.str();
+}
+
+template < class T, typename K >
+void Bench (const char* hashName, const char* tableName,
+            const fsu::Vector < K >& keys, size_t numbuckets,
+            fsu::Vector < Result >& results)
+{
+  T table(numbuckets);
+  Result r;
+  std::clock_t start;
+  size_t i, n = keys.Size(), found = 0;
+  DataType d;
+
+  r.hash_ = hashName;
+  r.table_ = tableName;
+
+  start = std::clock();
+  for (i = 0; i < n; ++i)
+    table.Insert(keys[i], (DataType)i);
+  r.insertNs_ = NsPerOp(start, n);
+
+  r.entries_ = table.Size();
+  r.buckets_ = table.NumBuckets();
+  r.bytesPerEntry_ = r.entries_ ? (double)table.Footprint() / r.entries_ : 0.0;
+  BucketStats(table, r);
+
+  start = std::clock();
+  for (i = 0; i < n; ++i)
+    found += table.Retrieve(keys[i], d);
+  r.lookupNs_ = NsPerOp(start, n);
+
+  start = std::clock();
+  for (i = 0; i < n; ++i)
+    table.Remove(keys[i]);
+  r.removeNs_ = NsPerOp(start, n);
+
+  if (found != n)
+    std::cerr << " ** " << hashName << '/' << tableName << ": "
+              << n - found << " keys not found\n";
+  results.PushBack(r);
+}
+
+template < class H, typename K >
+void BenchTables (const char* hashName, const fsu::Vector < K >& keys,
+                  size_t numbuckets, fsu::Vector < Result >& results)
+{
+  Bench < fsu::HashTable < K, DataType, H, fsu::PrimeBuckets > >
+    (hashName, "chain prime %", keys, numbuckets, results);
+  Bench < fsu::HashTable < K, DataType, H, fsu::PowerOfTwoBuckets > >
+    (hashName, "chain pow2 mask", keys, numbuckets, results);
+  Bench < fsu::HashTable < K, DataType, H, fsu::FastRangeBuckets > >
+    (hashName, "chain fast range", keys, numbuckets, results);
+  // an open table holds at most its slots: presize so it does not grow
+  Bench < fsu::OHashTable < K, DataType, H > >
+    (hashName, "open robin hood", keys,
+     numbuckets < keys.Size() ? keys.Size() : numbuckets, results);
+}
+
+static bool HexKey (const KeyType& s, ipNumber& ipn)
+{
+  if (s.Size() == 0 || s.Size() > 8)
+    return 0;
+  ipn = 0;
+  for (size_t i = 0; i < s.Size(); ++i)
+  {
+    char c = s[i];
+    if (!std::isxdigit(c))
+      return 0;
+    ipn = (ipn << 4) | (std::isdigit(c) ? c - '0' : std::toupper(c) - 'A' + 10);
+  }
+  return 1;
+}
 
 int main(int argc, char* argv[])
 {
-  typedef fsu::HashTable < KeyType, DataType, HashType > HashTableType;
   std::ifstream ifs;
   std::ofstream ofs;
-  int writetofile = 0;
   if (argc != 3 && argc != 4)
   {
     std::cout << " ** program requires 2 or 3 arguments\n"
 	      << "    1 = approx no of buckets (required)\n"
 	      << "    2 = input table filename (required)\n"
-	      << "    3 = output analysis filename (optional)\n"
+	      << "    3 = output CSV filename, - for screen (optional)\n"
 	      << " ** try again\n";
     exit(0);
   }
@@ -78,7 +198,7 @@ int main(int argc, char* argv[])
     exit(0);
   }
 
-  if (argc == 4)
+  if (argc == 4 && std::string(argv[3]) != "-")
   {
     ofs.open(argv[3]);
     if (ofs.fail())
@@ -87,32 +207,79 @@ int main(int argc, char* argv[])
 		<< " ** program closing\n";
       exit(0);
     }
-    writetofile = 1;
   }
 
   size_t numbuckets = atoi(argv[1]);
-  HashType hfo;
-  HashTableType * tablePtr = new HashTableType(numbuckets, hfo, prime);
 
-  KeyType k;
-  DataType d;
-  while (!ifs.eof())
+  fsu::Vector < KeyType > keys(0);
+  fsu::Vector < ipNumber > ipKeys(0);
+  KeyType k, data;  // data is not used: the tables map each key to its index
+  ipNumber ipn;
+  bool hex = 1;
+  while (ifs >> k >> data)
   {
-    ifs >> k >> d;
-    tablePtr->Insert(k,d);
+    keys.PushBack(k);
+    if (hex && HexKey(k, ipn))
+      ipKeys.PushBack(ipn);
+    else
+      hex = 0;
   }
   ifs.close();
-  std::cout << "  load completed\n" << std::flush;
+  if (!hex)
+  {
+    ipKeys.Clear();
+    for (size_t i = 0; i < keys.Size(); ++i)
+      ipKeys.PushBack(0x0A000000 + (ipNumber)(i / 200) * 256 + (ipNumber)(i % 200) + 1);
+  }
+  std::cout << "  load completed: " << keys.Size() << " keys, ipNumber keys "
+            << (hex ? "from file" : "generated") << '\n' << std::flush;
+
+  fsu::Vector < Result > results(0);
+  BenchTables < hashclass::Simple < KeyType > > ("Simple",    keys,   numbuckets, results);
+  BenchTables < hashclass::MM < KeyType > >     ("MM",        keys,   numbuckets, results);
+  BenchTables < hashclass::KISS < KeyType > >   ("KISS",      keys,   numbuckets, results);
+  BenchTables < hashclass::KISS < ipNumber > >  ("KISS ip",   ipKeys, numbuckets, results);
+  BenchTables < ipMultHash >                    ("MultShift", ipKeys, numbuckets, results);
+  BenchTables < ipFmixHash >                    ("Fmix32",    ipKeys, numbuckets, results);
+  BenchTables < ipCrcHash >                     ("CRC32C",    ipKeys, numbuckets, results);
 
-  if (writetofile)
+  std::cout << std::fixed << std::setprecision(2) << '\n'
+            << std::left << std::setw(11) << "hash" << std::setw(18) << "table" << std::right
+            << std::setw(9) << "entries" << std::setw(9) << "buckets"
+            << std::setw(10) << "ins ns" << std::setw(10) << "find ns" << std::setw(10) << "rem ns"
+            << std::setw(8) << "chain" << std::setw(6) << "max"
+            << std::setw(9) << "chi2/df" << std::setw(9) << "B/entry" << '\n';
+  for (size_t i = 0; i < results.Size(); ++i)
   {
-    tablePtr->Analysis(ofs);
-    ofs.close();
-    std::cout << "  analysis written to " << argv[3] << '\n';
+    const Result& r = results[i];
+    std::cout << std::left << std::setw(11) << r.hash_ << std::setw(18) << r.table_ << std::right
+              << std::setw(9) << r.entries_ << std::setw(9) << r.buckets_
+              << std::setw(10) << r.insertNs_ << std::setw(10) << r.lookupNs_
+              << std::setw(10) << r.removeNs_ << std::setw(8) << r.meanChain_
+              << std::setw(6) << r.maxBucket_ << std::setw(9) << r.chiSquare_
+              << std::setw(9) << r.bytesPerEntry_ << '\n'
+              << "             chains " << r.histogram_ << '\n';
   }
-  else
+
+  if (argc == 4)
   {
-    tablePtr->Analysis(std::cout);
+    std::ostream& csv = ofs.is_open() ? (std::ostream&)ofs : std::cout;
+    csv << std::fixed << std::setprecision(3)
+        << "hash,table,entries,buckets,insert_ns,lookup_ns,remove_ns,"
+        << "mean_chain,max_bucket,chi2_df,bytes_per_entry,histogram\n";
+    for (size_t i = 0; i < results.Size(); ++i)
+    {
+      const Result& r = results[i];
+      csv << r.hash_ << ',' << r.table_ << ',' << r.entries_ << ',' << r.buckets_ << ','
+          << r.insertNs_ << ',' << r.lookupNs_ << ',' << r.removeNs_ << ','
+          << r.meanChain_ << ',' << r.maxBucket_ << ',' << r.chiSquare_ << ','
+          << r.bytesPerEntry_ << ',' << r.histogram_ << '\n';
+    }
+    if (ofs.is_open())
+    {
+      ofs.close();
+      std::cout << "  CSV written to " << argv[3] << '\n';
+    }
   }
   return 0;
 }
@@ -0,0 +1,300 @@
+/*
+    hashnode.h
+
+    Bucket chains and node allocators for HashTable <K, D, H, P, A>
+
+    HashNode < T >       = one entry and the link to the next
+    HashChain < T >      = a bucket: a singly linked chain of nodes
+    HashChainIterator<T> = read-only iterator over a chain
+
+    A HashChain does not own its nodes. The table allocates them from
+    its allocator, links them in with PushFront, and takes them out
+    with Unlink or Release to relink them elsewhere (Rehash) or destroy
+    and deallocate them. Copying a chain copies the head pointer only.
+
+    Chains hold Entry <K,D> values and are searched by key: Find(q)
+    returns the link (head or a node's next_) that points to the node
+    whose value_.key_ == q, or to the null that ends the chain, so a
+    Remove or an Insert needs one search and no back pointers. q may be
+    a K or any type that compares with K (see KeyView in hashpolicy.h);
+    no Entry is built to search.
+
+    Node allocators, the A parameter of HashTable <K, D, H, P, A>:
+
+    NodeHeap             = each node from global operator new and back to
+                           delete; memory is returned as entries are removed
+    NodeArena            = nodes carved from slabs of growing size (64
+                           nodes, doubling to 65536), so the nodes of a
+                           table are contiguous in allocation order; a
+                           removed node goes on a free list for the next
+                           insert, and slabs are freed only by Release
+
+    Both have Allocate(bytes), Deallocate(p, bytes), Release() and
+    Footprint() (bytes held). releasesAll is true when Release() frees
+    every node at once, which lets HashTable::Clear drop the chains
+    without visiting the nodes when the entries need no destructor.
+    All the nodes of one allocator must be the same size.
+*/
+
+#ifndef _HASHNODE_H
+#define _HASHNODE_H
+
+#include <cstddef>
+#include <new>
+#include <utility> // std::move
+
+namespace fsu
+{
+
+  //--------------------------------------------
+  //     HashNode <T>, HashChain <T>
+  //--------------------------------------------
+
+  template <typename T>
+  struct HashNode
+  {
+    T          value_;
+    HashNode*  next_;
+
+    explicit HashNode (const T& t) : value_(t), next_(0) {}
+    explicit HashNode (T&& t) : value_(std::move(t)), next_(0) {}
+  } ;
+
+  template <typename T>
+  class HashChainIterator
+  {
+  public:
+    typedef HashNode<T>   Node;
+
+    bool     Valid        () const { return node_ != 0; }
+    const T& operator *   () const { return node_->value_; }
+    HashChainIterator& operator ++ ()    { node_ = node_->next_; return *this; }
+    HashChainIterator  operator ++ (int) { HashChainIterator i = *this; node_ = node_->next_; return i; }
+    bool     operator ==  (const HashChainIterator& i) const { return node_ == i.node_; }
+    bool     operator !=  (const HashChainIterator& i) const { return node_ != i.node_; }
+
+    HashChainIterator () : node_(0) {}
+    explicit HashChainIterator (const Node* n) : node_(n) {}
+
+  private:
+    const Node*  node_;
+  } ;
+
+  template <typename T>
+  class HashChain
+  {
+  public:
+    typedef T                       ValueType;
+    typedef HashNode<T>             Node;
+    typedef HashChainIterator<T>    Iterator;
+    typedef HashChainIterator<T>    ConstIterator;
+
+    bool           Empty     () const { return head_ == 0; }
+    size_t         Size      () const;
+    ConstIterator  Begin     () const { return ConstIterator(head_); }
+    ConstIterator  End       () const { return ConstIterator(); }
+    template <class Q>
+    ConstIterator  Includes  (const Q& key) const;
+
+    template <class Q>
+    Node**         Find      (const Q& key);
+    void           PushFront (Node* n);
+    Node*          Unlink    (Node** link);   // *link != 0
+    Node*          Release   ();              // whole chain, leaving this empty
+
+    HashChain () : head_(0) {}
+
+  private:
+    Node*  head_;
+  } ;
+
+  template <typename T>
+  size_t HashChain<T>::Size () const
+  {
+    size_t n = 0;
+    for (const Node* p = head_; p != 0; p = p->next_)
+      ++n;
+    return n;
+  }
+
+  template <typename T>
+  template <class Q>
+  typename HashChain<T>::ConstIterator HashChain<T>::Includes (const Q& key) const
+  {
+    const Node* p = head_;
+    while (p != 0 && !(p->value_.key_ == key))
+      p = p->next_;
+    return ConstIterator(p);
+  }
+
+  template <typename T>
+  template <class Q>
+  typename HashChain<T>::Node** HashChain<T>::Find (const Q& key)
+  {
+    Node** link = &head_;
+    while (*link != 0 && !((*link)->value_.key_ == key))
+      link = &(*link)->next_;
+    return link;
+  }
+
+  template <typename T>
+  void HashChain<T>::PushFront (Node* n)
+  {
+    n->next_ = head_;
+    head_ = n;
+  }
+
+  template <typename T>
+  typename HashChain<T>::Node* HashChain<T>::Unlink (Node** link)
+  {
+    Node* n = *link;
+    *link = n->next_;
+    return n;
+  }
+
+  template <typename T>
+  typename HashChain<T>::Node* HashChain<T>::Release ()
+  {
+    Node* n = head_;
+    head_ = 0;
+    return n;
+  }
+
+  //--------------------------------------------
+  //     NodeHeap
+  //--------------------------------------------
+
+  class NodeHeap
+  {
+  public:
+    void*   Allocate    (size_t bytes)
+    {
+      void* p = ::operator new(bytes);
+      bytes_ += bytes;
+      return p;
+    }
+    void    Deallocate  (void* p, size_t bytes)
+    {
+      ::operator delete(p);
+      bytes_ -= bytes;
+    }
+    void    Release     () {}
+    size_t  Footprint   () const { return bytes_; }
+
+    static const bool releasesAll = 0;
+
+    NodeHeap () : bytes_(0) {}
+
+  private:
+    size_t  bytes_;
+
+    // prevent copying - do not implement
+    NodeHeap              (const NodeHeap&);
+    NodeHeap& operator =  (const NodeHeap&);
+  } ;
+
+  //--------------------------------------------
+  //     NodeArena
+  //--------------------------------------------
+
+  class NodeArena
+  {
+  public:
+    void*   Allocate    (size_t bytes);
+    void    Deallocate  (void* p, size_t bytes);
+    void    Release     ();
+    size_t  Footprint   () const { return bytes_; }
+
+    static const bool releasesAll = 1;
+
+    NodeArena  ();
+    ~NodeArena ();
+
+  private:
+    struct Free { Free* next_; };
+    struct Slab { Slab* next_; };   // header at the start of each slab
+
+    static const size_t firstSlab = 64;     // nodes
+    static const size_t maxSlab   = 65536;
+    static const size_t align     = sizeof(long double) > sizeof(void*) ? sizeof(long double) : sizeof(void*);
+
+    Slab*   slabs_;
+    char*   next_;       // next unused node of the newest slab
+    char*   end_;
+    Free*   free_;       // deallocated nodes
+    size_t  nodeSize_;   // set by the first Allocate
+    size_t  slabNodes_;  // nodes in the next slab
+    size_t  bytes_;
+
+    void    NewSlab     ();
+
+    // prevent copying - do not implement
+    NodeArena              (const NodeArena&);
+    NodeArena& operator =  (const NodeArena&);
+  } ;
+
+  inline NodeArena::NodeArena ()
+    : slabs_(0), next_(0), end_(0), free_(0), nodeSize_(0), slabNodes_(firstSlab), bytes_(0)
+  {}
+
+  inline NodeArena::~NodeArena ()
+  {
+    Release();
+  }
+
+  inline void* NodeArena::Allocate (size_t bytes)
+  {
+    if (free_ != 0)
+    {
+      Free* f = free_;
+      free_ = f->next_;
+      return f;
+    }
+    if (nodeSize_ == 0)
+      nodeSize_ = ((bytes < sizeof(Free) ? sizeof(Free) : bytes) + align - 1) / align * align;
+    if (next_ == end_)
+      NewSlab();
+    void* p = next_;
+    next_ += nodeSize_;
+    return p;
+  }
+
+  inline void NodeArena::Deallocate (void* p, size_t)
+  {
+    Free* f = static_cast<Free*>(p);
+    f->next_ = free_;
+    free_ = f;
+  }
+
+  inline void NodeArena::NewSlab ()
+  {
+    size_t header = (sizeof(Slab) + align - 1) / align * align;
+    size_t size = header + slabNodes_ * nodeSize_;
+    char* s = static_cast<char*>(::operator new(size));
+    Slab* slab = reinterpret_cast<Slab*>(s);
+    slab->next_ = slabs_;
+    slabs_ = slab;
+    next_ = s + header;
+    end_ = s + size;
+    bytes_ += size;
+    if (slabNodes_ < maxSlab)
+      slabNodes_ *= 2;
+  }
+
+  inline void NodeArena::Release ()
+  {
+    while (slabs_ != 0)
+    {
+      Slab* s = slabs_;
+      slabs_ = s->next_;
+      ::operator delete(s);
+    }
+    next_ = end_ = 0;
+    free_ = 0;
+    slabNodes_ = firstSlab;
+    bytes_ = 0;
+  }
+
+} // namespace fsu
+
+#endif
@@ -0,0 +1,229 @@
+/*
+    hashpolicy.h
+
+    Definitions shared by the hash tables in hashtbl.h and ohashtbl.h
+
+    DuplicatePolicy      = what BulkLoad does with a key that occurs more
+                           than once (in the input, or in the input and
+                           the table): keepFirst keeps the data seen
+                           first, keepLast the data seen last, the same
+                           as a sequence of Insert calls would
+    FSU_PREFETCH(p)      = hint that the memory at p will be read soon
+    LowestBit(w)         = index of the lowest set bit of w (w != 0)
+    HashBatch(h, k, v, n) = v[i] = h(k[i]) for i < n, the batch hashing
+                           used by LookupBatch; overload it for a hash
+                           functor with a faster (vector) form
+
+    Bucket policies, the P parameter of HashTable <K, D, H, P>:
+
+    PrimeBuckets         = bucket count rounded down to a prime (if asked),
+                           bucket = hash % count; needed by hash functions
+                           whose low bits are poor, such as Simple
+    PowerOfTwoBuckets    = bucket count rounded up to a power of 2,
+                           bucket = Finalize(hash) & (count - 1)
+    FastRangeBuckets     = bucket count as given,
+                           bucket = (Finalize(hash) high 32 bits * count) >> 32
+
+    Buckets(n, prime) gives the bucket count used for a request of n,
+    Grow(count) the request an automatic resize makes to double a table
+    (2 * count + 1, or 2 * count for powers of 2, which would otherwise
+    round up to 4 * count) and Reduce(h, count) maps a hash value to a
+    bucket. The last two policies replace the division by a mask or a
+    multiply; Finalize (the MurmurHash3 64-bit finalizer) spreads every
+    bit of the hash into the bits they use, so a hash like KISS keeps its
+    chain lengths without the prime.
+
+    Heterogeneous lookup:
+
+    IfTransparent<H, R>::type = R if the hash functor H declares a type
+                           is_transparent (of any type, through
+                           Void<T>::type = void), and no type otherwise; the
+                           tables use it to offer Retrieve, Includes and
+                           Remove for any key type Q that H hashes to
+                           the value of the equal K and that compares
+                           with K by key_ == q
+    KeyView              = characters not owned (pointer and length),
+                           equal to any string type with Size() and
+                           operator[] holding the same characters
+    StringKeyHash        = transparent FNV-1a hash of the characters of
+                           a string type, KeyView or C string, so a
+                           table of fsu::String keys can be searched for
+                           a KeyView without building a String
+*/
+
+#ifndef _HASHPOLICY_H
+#define _HASHPOLICY_H
+
+#ifndef FSU_PREFETCH
+#if defined(__GNUC__)
+#define FSU_PREFETCH(p) __builtin_prefetch((p))
+#else
+#define FSU_PREFETCH(p)
+#endif
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <primes.h>
+
+namespace fsu
+{
+
+  inline size_t LowestBit (uint64_t w)
+  {
+#if defined(__GNUC__)
+    return (size_t)__builtin_ctzll(w);
+#else
+    size_t i = 0;
+    while ((w & 1) == 0)
+    {
+      w >>= 1;
+      ++i;
+    }
+    return i;
+#endif
+  }
+
+  enum DuplicatePolicy
+  {
+    keepFirst, keepLast
+  } ;
+
+  template <class H, typename K>
+  void HashBatch (const H& h, const K* keys, size_t* hashes, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+      hashes[i] = h(keys[i]);
+  }
+
+  inline uint64_t Finalize (uint64_t h)
+  {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  struct PrimeBuckets
+  {
+    static size_t Buckets (size_t n, bool prime)
+    {
+      if (n < 3)
+        return 2;
+      return prime ? fsu::PrimeBelow(n) : n;
+    }
+    static size_t Grow (size_t numBuckets)
+    {
+      return 2 * numBuckets + 1;
+    }
+    static size_t Reduce (size_t h, size_t numBuckets)
+    {
+      return h % numBuckets;
+    }
+  } ;
+
+  struct PowerOfTwoBuckets
+  {
+    static size_t Buckets (size_t n, bool)
+    {
+      size_t b = 2;
+      while (b < n)
+        b <<= 1;
+      return b;
+    }
+    static size_t Grow (size_t numBuckets)
+    {
+      return 2 * numBuckets;
+    }
+    static size_t Reduce (size_t h, size_t numBuckets)
+    {
+      return (size_t)Finalize(h) & (numBuckets - 1);
+    }
+  } ;
+
+  struct FastRangeBuckets
+  {
+    static size_t Buckets (size_t n, bool)
+    {
+      return (n < 2) ? 2 : n;
+    }
+    static size_t Grow (size_t numBuckets)
+    {
+      return 2 * numBuckets + 1;
+    }
+    static size_t Reduce (size_t h, size_t numBuckets)
+    // pre:  numBuckets < 2^32
+    {
+      return (size_t)(((Finalize(h) >> 32) * (uint64_t)numBuckets) >> 32);
+    }
+  } ;
+
+  template <typename T>
+  struct Void
+  {
+    typedef void type;
+  } ;
+
+  template <class H, typename R, typename T = void>
+  struct IfTransparent
+  {} ;
+
+  // any is_transparent type will do, as with std::less<>
+  template <class H, typename R>
+  struct IfTransparent < H, R, typename Void < typename H::is_transparent >::type >
+  {
+    typedef R type;
+  } ;
+
+  class KeyView
+  {
+  public:
+    size_t  Size        () const { return size_; }
+    char    operator [] (size_t i) const { return data_[i]; }
+
+    KeyView (const char* s) : data_(s), size_(std::strlen(s)) {}
+    KeyView (const char* s, size_t n) : data_(s), size_(n) {}
+
+  private:
+    const char*  data_;
+    size_t       size_;
+  } ;
+
+  template <class S>
+  bool operator == (const S& s, const KeyView& v)
+  {
+    if (s.Size() != v.Size())
+      return 0;
+    for (size_t i = 0; i < v.Size(); ++i)
+      if (s[i] != v[i])
+        return 0;
+    return 1;
+  }
+
+  struct StringKeyHash
+  {
+    typedef void is_transparent;
+
+    template <class S>
+    size_t operator () (const S& s) const
+    {
+      uint64_t h = 0xCBF29CE484222325ull;
+      for (size_t i = 0; i < s.Size(); ++i)
+      {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001B3ull;
+      }
+      return (size_t)h;
+    }
+    size_t operator () (const char* s) const
+    {
+      return operator()(KeyView(s));
+    }
+  } ;
+
+} // namespace fsu
+
+#endif
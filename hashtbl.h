@@ -1,22 +1,41 @@
 /*
     hashtbl.h
 
-    Defining the classes HashTable <K, D, H>
-                     and HashTable <K, D, H> :: Iterator
+    Defining the classes HashTable <K, D, H, P, A>
+                     and HashTable <K, D, H, P, A> :: Iterator
 
     K                    = KeyType
     D                    = DataType
     Entry < K , D >      = EntryType
     H                    = HashType
-    List < EntryType >   = BucketType
+    P                    = BucketPolicy (see hashpolicy.h), default
+                           PrimeBuckets
+    A                    = NodeAllocator (see hashnode.h), default
+                           NodeHeap
+    HashChain < EntryType > = BucketType
 
     Note: a possible point of confusion is that
           BucketType  :: ValueType is Entry<K,D>, while
           Entry<K,D> :: ValueType is D.
 
-    The return type of HashTable<K, D, H>::Iterator::operator* is
+    The return type of HashTable<K, D, H, P>::Iterator::operator* is
     ValueType&, which means that (*I).data_ has type DataType&.
 
+    Each entry is a node of its bucket's chain, allocated from the
+    table's A. Rehash and migration relink the nodes into their new
+    buckets, so an entry is never copied or reallocated once inserted,
+    and with NodeArena Clear releases all nodes at once.
+
+    Chains are searched by key, so Retrieve, Includes and Remove copy
+    nothing, and an insert copies the key and data once, into the new
+    node, moving each one that is an rvalue (Insert has all four
+    combinations, Emplace and Get both forms of the key).
+
+    Compiling with HASHTBL_PROBE_COUNT defined makes Retrieve, Includes
+    and LookupBatch count the searches and the entries examined, for
+    Analysis to report. The counters are relaxed atomics, added to once
+    per Retrieve or Includes and once per LookupBatch group.
+
 */
 
 #ifndef _HASHTBL_H
@@ -25,60 +44,131 @@
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
-// #include <cmath>    // used by Analysis in hashtbl.cpp
+#include <stdint.h>
+#ifdef HASHTBL_PROBE_COUNT
+#include <atomic>
+#endif
+
+#include <type_traits>
+#include <utility> // std::move, std::forward
 
 #include <entry.h>
 #include <vector.h>
-#include <list.h>
 #include <primes.h>
 #include <genalg.h> // Swap()
+#include <hashpolicy.h>
+#include <hashnode.h>
 
 namespace fsu
 {
 
-  template <typename K, typename D, class H>
+  template <typename K, typename D, class H, class P = PrimeBuckets, class A = NodeHeap>
   class HashTable;
 
-  template <typename K, typename D, class H>
+  template <typename K, typename D, class H, class P = PrimeBuckets, class A = NodeHeap>
   class HashTableIterator;
 
   //--------------------------------------------
-  //     HashTable <K,D,H>
+  //     HashTable <K,D,H,P,A>
   //--------------------------------------------
 
-  template <typename K, typename D, class H>
+  template <typename K, typename D, class H, class P, class A>
   class HashTable
   {
-    friend class HashTableIterator <K,D,H>;
+    friend class HashTableIterator <K,D,H,P,A>;
   public:
     typedef K                                KeyType;
     typedef D                                DataType;
     typedef fsu::Entry<K,D>                  EntryType;
-    typedef fsu::List<EntryType>             BucketType;
+    typedef fsu::HashChain<EntryType>        BucketType;
     typedef H                                HashType;
+    typedef P                                BucketPolicy;
+    typedef A                                NodeAllocator;
     typedef typename BucketType::ValueType   ValueType;
-    typedef HashTableIterator<K,D,H>         Iterator;
-    typedef HashTableIterator<K,D,H>         ConstIterator;
+    typedef HashTableIterator<K,D,H,P,A>       Iterator;
+    typedef HashTableIterator<K,D,H,P,A>       ConstIterator;
 
     // ADT Table
+    // each of k and d is moved rather than copied when it is an rvalue
     Iterator       Insert        (const K& k, const D& d);
+    Iterator       Insert        (K&& k, const D& d);
+    Iterator       Insert        (const K& k, D&& d);
+    Iterator       Insert        (K&& k, D&& d);
     bool           Remove        (const K& k);
     bool           Retrieve      (const K& k, D& d) const;
     Iterator       Includes      (const K& k) const;
 
+    // Emplace inserts k with data D(args...) if k is not in the table,
+    // and otherwise leaves the entry, and args, alone; either way it
+    // returns the entry's iterator
+    template <typename... Args>
+    Iterator       Emplace       (const K& k, Args&&... args);
+    template <typename... Args>
+    Iterator       Emplace       (K&& k, Args&&... args);
+
+    // Heterogeneous lookup, when H is transparent (IfTransparent in
+    // hashpolicy.h): the same for a key q of another type Q, such as a
+    // KeyView of characters in a buffer, without converting q to K
+    template <class Q, class HH = H>
+    typename IfTransparent<HH, bool>::type      Remove   (const Q& q);
+    template <class Q, class HH = H>
+    typename IfTransparent<HH, bool>::type      Retrieve (const Q& q, D& d) const;
+    template <class Q, class HH = H>
+    typename IfTransparent<HH, Iterator>::type  Includes (const Q& q) const;
+
+    // Retrieve for n keys at once: found[i] is set to 1 and data[i] to the
+    // data of keys[i] if keys[i] is in the table, otherwise found[i] is 0.
+    // Bucket addresses for a group of keys are computed and prefetched
+    // before any of them is searched, overlapping the cache misses. The
+    // group is hashed by HashBatch (hashpolicy.h), which hash functors
+    // may overload with a vectorized form (see iphash.h).
+    void           LookupBatch   (const K* keys, D* data, uint8_t* found, size_t n) const;
+
     // ADT Associative Array
     D&      Get        (const K& key);
+    D&      Get        (K&& key);
     void    Put        (const K& key, const D& data);
     D&      operator[] (const K& key);
 
+    // Insert every Entry<K,D> in [first, last) at once. Entries are
+    // counted, the table is (optionally) rehashed to at least one bucket
+    // per entry, and the entries are distributed to buckets counting-sort
+    // style. Each entry is then resolved by policy with one search of its
+    // bucket list, which holds the keys in the table before the load and
+    // those of the group linked so far, so a group of g entries costs
+    // O(g) searches of lists that presizing keeps short.
+    template <class I>
+    void           BulkLoad      (I first, I last, DuplicatePolicy policy = keepLast, bool presize = 1);
+
+    // Rehash to numBuckets buckets (default: one per entry). An incremental
+    // rehash only allocates the new buckets; the old ones are kept and
+    // migrated a few at a time by later Insert, Get and Remove calls, so
+    // no single call moves the whole table. Until migration is complete a
+    // key whose old bucket has not been migrated is found, and inserted,
+    // in its old bucket. Rehashing again completes a pending migration.
     void           Clear         ();
-    void           Rehash        (size_t numBuckets = 0);
+    void           Rehash        (size_t numBuckets = 0, bool incremental = 0);
+    bool           Migrating     () const;
     size_t         Size          () const;
     bool           Empty         () const;
+    size_t         NumBuckets    () const;
+    size_t         BucketSize    (size_t b) const;   // entries in bucket b < NumBuckets()
+    size_t         Footprint     () const;   // approximate bytes allocated, nodes as held by A
+
+    // Automatic resizing, off by default: once Size() exceeds maxLoad per
+    // bucket an insert starts an incremental Rehash to twice the buckets,
+    // and once it falls below minLoad (if not 0) a remove starts one to
+    // half. minLoad is kept at or below maxLoad / 2 so a resize never
+    // triggers the opposite one. maxLoad 0 turns resizing off.
+    void           SetLoadFactors (double maxLoad, double minLoad = 0);
+    double         LoadFactor    () const;   // Size() / NumBuckets()
+    size_t         ResizeCount   () const;   // automatic resizes so far
 
     // Iterator       Begin         ();
     // Iterator       End           ();
 
+    // Begin() is amortized O(1): it starts from a lower bound on the first
+    // non-empty bucket, which inserts lower and Begin() raises; End() is O(1)
     ConstIterator  Begin         () const;
     ConstIterator  End           () const;
 
@@ -89,324 +179,930 @@ namespace fsu
 
     // these are for debugging and analysis
     void           Dump          (std::ostream& os, int c1 = 0, int c2 = 0) const;
-    // size_t         MaxBucketSize () const;
-    // void           Analysis      (std::ostream& os) const;
-    // NOTE: Analysis will be covered in COP 4531
+    size_t         MaxBucketSize () const;
+    void           Analysis      (std::ostream& os) const;
+    // Analysis: load factor, empty buckets, chain length histogram, and
+    // expected vs actual probes; O(buckets) time, no allocation
 
   private:
     // data
     size_t                 numBuckets_;
     Vector < BucketType >  bucketVector_;
     HashType               hashObject_;
+    size_t                 size_;      // entries in all buckets
+    Vector < uint64_t >    occupied_;  // bit b is set iff bucket b is not empty
+    mutable size_t         firstOccupied_; // no bucket below this is non-empty
+    size_t                 oldNumBuckets_; // 0 unless migrating
+    Vector < BucketType >  oldVector_;
+    size_t                 migrateNext_;   // old buckets below this are empty
+
+    static const size_t    migrateStep = 8; // old buckets moved per update
+
+    double                 maxLoad_;
+    double                 minLoad_;
+    size_t                 resizeCount_;
+    A                      alloc_;
+
+    typedef typename BucketType::Node  Node;
+    Node*   NewNode        (EntryType&& e);
+    void    DeleteNode     (Node* n);
+    void    DeleteChain    (Node* n);   // DeleteNode each, or only destroy if A releases all
+
+    // the shared bodies of the K, K&& and Q forms
+    template <class Q>
+    typename BucketType::ConstIterator Lookup (const Q& q, size_t& bucketNum) const;
+    template <class Q>
+    bool      Erase          (const Q& q);
+    template <class KK, class DD>
+    Node*     Store          (size_t& bucketNum, KK&& k, DD&& d);
+    template <class KK, typename... Args>
+    Node*     Construct      (size_t& bucketNum, KK&& k, Args&&... args);
+    Node*     Link           (size_t& bucketNum, Node* node);  // a new entry, then Resize
+    Iterator  MakeIterator   (size_t bucketNum, const Node* node) const;
+
+#ifdef HASHTBL_PROBE_COUNT
+    mutable std::atomic < size_t > searches_;
+    mutable std::atomic < size_t > probes_;
+    template <class Q>
+    typename BucketType::ConstIterator Search (const BucketType& bucket, const Q& q,
+                                               size_t& probes) const;
+#endif
 
     // private method calculates bucket index
     size_t  Index          (const KeyType& k) const;
 
+    // While migrating, buckets are numbered 0 .. numBuckets_ - 1 in
+    // bucketVector_ followed by numBuckets_ + j for oldVector_[j]
+    size_t              Home   (const KeyType& k) const;  // bucket that holds k, if present
+    size_t              HomeOf (size_t hash) const;       // Home() given k's hash value
+    BucketType&         Bucket (size_t b);
+    const BucketType&   Bucket (size_t b) const;
+    size_t              NextBucket (size_t b) const;     // first non-empty bucket >= b
+    void                Migrate (size_t count);          // move up to count old buckets
+    void                Resize  ();                      // apply the load factors
+
+    // occupancy bitmap maintenance
+    void    InitOccupied   ();
+    void    Occupy         (size_t b);
+    void    Vacate         (size_t b);           // if bucket b is now empty
+    size_t  NextOccupied   (size_t b) const;     // first non-empty bucket >= b, else numBuckets_
+
     // prevent copying - do not implement
-    HashTable              (const HashTable<K,D,H>&);
+    HashTable              (const HashTable<K,D,H,P,A>&);
     HashTable& operator =  (const HashTable&);
   } ;
 
   //--------------------------------------------
-  //     HashTableIterator <K,D,H>
+  //     HashTableIterator <K,D,H,P,A>
   //--------------------------------------------
 
   // Note: This is a ConstIterator - cannot be used to modify table
 
-  template <typename K, typename D, class H>
+  template <typename K, typename D, class H, class P, class A>
   class HashTableIterator
   {
-    friend class HashTable <K,D,H>;
+    friend class HashTable <K,D,H,P,A>;
   public:
     typedef K                                KeyType;
     typedef D                                DataType;
     typedef fsu::Entry<K,D>                  EntryType;
-    typedef fsu::List<EntryType>             BucketType;
+    typedef fsu::HashChain<EntryType>        BucketType;
     typedef H                                HashType;
+    typedef P                                BucketPolicy;
+    typedef A                                NodeAllocator;
     typedef typename BucketType::ValueType   ValueType;
-    typedef HashTableIterator<K,D,H>         Iterator;
-    typedef HashTableIterator<K,D,H>         ConstIterator;
+    typedef HashTableIterator<K,D,H,P,A>       Iterator;
+    typedef HashTableIterator<K,D,H,P,A>       ConstIterator;
 
     HashTableIterator   ();
     HashTableIterator   (const Iterator& i);
     bool Valid          () const;
-    HashTableIterator <K,D,H>& operator =  (const Iterator& i);
-    HashTableIterator <K,D,H>& operator ++ ();
-    HashTableIterator <K,D,H>  operator ++ (int);
+    HashTableIterator <K,D,H,P,A>& operator =  (const Iterator& i);
+    HashTableIterator <K,D,H,P,A>& operator ++ ();
+    HashTableIterator <K,D,H,P,A>  operator ++ (int);
     // Entry <K,D>&               operator * ();
     const Entry <K,D>&         operator *  () const;
     bool                       operator == (const Iterator& i2) const;
     bool                       operator != (const Iterator& i2) const;
 
   protected:
-    const HashTable <K,D,H> *           tablePtr_;
+    const HashTable <K,D,H,P,A> *           tablePtr_;
     size_t                              bucketNum_;
     typename BucketType::ConstIterator  bucketItr_;
   } ;
 
   //--------------------------------------------
-  //     HashTable <K,D,H>
+  //     HashTable <K,D,H,P,A>
   //--------------------------------------------
 
   // ADT Table
 
-  template <typename K, typename D, class H>
-  HashTableIterator<K,D,H> HashTable<K,D,H>::Insert (const K& k, const D& d)
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Insert (const K& k, const D& d)
   {
-    HashTableIterator<K,D,H> i;
-    EntryType e(k, d);
-	typename BucketType::Iterator bucketItr;
+    size_t b;
+    Node* node = Store(b, k, d);
+    return MakeIterator(b, node);
+  }
 
-    i.tablePtr_ = this;
-    i.bucketNum_ = Index(k);
-    bucketItr = bucketVector_[i.bucketNum_].Includes(e);
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Insert (K&& k, const D& d)
+  {
+    size_t b;
+    Node* node = Store(b, std::move(k), d);
+    return MakeIterator(b, node);
+  }
 
-    if (bucketItr == bucketVector_[i.bucketNum_].End())
-      bucketItr = bucketVector_[i.bucketNum_].Insert(e);
-    else
-      (*bucketItr).data_ = d;
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Insert (const K& k, D&& d)
+  {
+    size_t b;
+    Node* node = Store(b, k, std::move(d));
+    return MakeIterator(b, node);
+  }
 
-	i.bucketItr_ = bucketItr;
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Insert (K&& k, D&& d)
+  {
+    size_t b;
+    Node* node = Store(b, std::move(k), std::move(d));
+    return MakeIterator(b, node);
+  }
 
-    return i;
+  template <typename K, typename D, class H, class P, class A>
+  template <typename... Args>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Emplace (const K& k, Args&&... args)
+  {
+    size_t b;
+    Node* node = Construct(b, k, std::forward<Args>(args)...);
+    return MakeIterator(b, node);
   }
 
-  template <typename K, typename D, class H>
-  bool HashTable<K,D,H>::Remove (const K& k)
+  template <typename K, typename D, class H, class P, class A>
+  template <typename... Args>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Emplace (K&& k, Args&&... args)
   {
-    EntryType e(k);
-    size_t bucketNum = Index(k);
-    typename BucketType::Iterator i;
+    size_t b;
+    Node* node = Construct(b, std::move(k), std::forward<Args>(args)...);
+    return MakeIterator(b, node);
+  }
 
-    i = bucketVector_[bucketNum].Includes(e);
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTable<K,D,H,P,A>::Remove (const K& k)
+  {
+    return Erase(k);
+  }
 
-    if (i == bucketVector_[bucketNum].End())
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTable<K,D,H,P,A>::Retrieve (const K& k, D& d) const
+  {
+    size_t bucketNum;
+    typename BucketType::ConstIterator i = Lookup(k, bucketNum);
+    if (!i.Valid())
       return false;
-    else
-    {
-      bucketVector_[bucketNum].Remove(i);
-      return true;
-    }
+    d = (*i).data_;
+    return true;
   }
 
-  template <typename K, typename D, class H>
-  bool HashTable<K,D,H>::Retrieve (const K& k, D& d) const
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Includes (const K& k) const
   {
-    EntryType e(k);
-    size_t bucketNum = Index(k);
-    typename BucketType::ConstIterator i;
+    HashTableIterator<K,D,H,P,A> i;
+    i.bucketItr_ = Lookup(k, i.bucketNum_);
+    if (!i.bucketItr_.Valid())
+      return End();
+    i.tablePtr_ = this;
+    return i;
+  }
 
-    i = bucketVector_[bucketNum].Includes(e);
+  template <typename K, typename D, class H, class P, class A>
+  template <class Q, class HH>
+  typename IfTransparent<HH, bool>::type HashTable<K,D,H,P,A>::Remove (const Q& q)
+  {
+    return Erase(q);
+  }
 
-    if (i == bucketVector_[bucketNum].End())
+  template <typename K, typename D, class H, class P, class A>
+  template <class Q, class HH>
+  typename IfTransparent<HH, bool>::type HashTable<K,D,H,P,A>::Retrieve (const Q& q, D& d) const
+  {
+    size_t bucketNum;
+    typename BucketType::ConstIterator i = Lookup(q, bucketNum);
+    if (!i.Valid())
       return false;
-    else
-    {
-      d = (*i).data_;
-      return true;
-    }
+    d = (*i).data_;
+    return true;
   }
 
-  template <typename K, typename D, class H>
-  HashTableIterator<K,D,H> HashTable<K,D,H>::Includes (const K& k) const
+  template <typename K, typename D, class H, class P, class A>
+  template <class Q, class HH>
+  typename IfTransparent<HH, HashTableIterator<K,D,H,P,A> >::type
+  HashTable<K,D,H,P,A>::Includes (const Q& q) const
   {
-    HashTableIterator<K,D,H> i;
-    EntryType e(k);
-    size_t bucketNum = Index(k);
-    typename BucketType::ConstIterator bucketItr;
+    HashTableIterator<K,D,H,P,A> i;
+    i.bucketItr_ = Lookup(q, i.bucketNum_);
+    if (!i.bucketItr_.Valid())
+      return End();
+    i.tablePtr_ = this;
+    return i;
+  }
 
-    bucketItr = bucketVector_[bucketNum].Includes(e);
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::LookupBatch (const K* keys, D* data, uint8_t* found, size_t n) const
+  {
+    const size_t groupSize = 16;
+    size_t bucketNum[groupSize], hash[groupSize];
+    typename BucketType::ConstIterator i;
 
-    if (bucketItr == bucketVector_[bucketNum].End())
-      i = End();
-    else
+    for (size_t base = 0; base < n; base += groupSize)
     {
-      i.tablePtr_ = this;
-      i.bucketNum_ = bucketNum;
-      i.bucketItr_ = bucketItr;
-    }
+      size_t m = (n - base < groupSize) ? n - base : groupSize;
 
-    return i;
+      // stage 1: bucket indices, prefetch the bucket (chain head) objects
+      HashBatch(hashObject_, keys + base, hash, m);
+      for (size_t j = 0; j < m; ++j)
+      {
+        bucketNum[j] = HomeOf(hash[j]);
+        FSU_PREFETCH(&Bucket(bucketNum[j]));
+      }
+      // stage 2: prefetch the first entry of each non-empty bucket
+      for (size_t j = 0; j < m; ++j)
+      {
+        if (!Bucket(bucketNum[j]).Empty())
+          FSU_PREFETCH(&*Bucket(bucketNum[j]).Begin());
+      }
+      // stage 3: search the buckets
+#ifdef HASHTBL_PROBE_COUNT
+      size_t probes = 0;
+#endif
+      for (size_t j = 0; j < m; ++j)
+      {
+#ifdef HASHTBL_PROBE_COUNT
+        i = Search(Bucket(bucketNum[j]), keys[base + j], probes);
+#else
+        i = Bucket(bucketNum[j]).Includes(keys[base + j]);
+#endif
+        if (i == Bucket(bucketNum[j]).End())
+          found[base + j] = 0;
+        else
+        {
+          data[base + j] = (*i).data_;
+          found[base + j] = 1;
+        }
+      }
+#ifdef HASHTBL_PROBE_COUNT
+      searches_.fetch_add(m, std::memory_order_relaxed);
+      probes_.fetch_add(probes, std::memory_order_relaxed);
+#endif
+    }
   }
 
   // ADT Associative Array
 
-  template <typename K, typename D, class H>
-  D& HashTable<K,D,H>::Get (const K& key)
+  template <typename K, typename D, class H, class P, class A>
+  D& HashTable<K,D,H,P,A>::Get (const K& key)
   {
-    typename BucketType::Iterator i;
-    size_t bucketNum = Index(key);
-    EntryType e(key);
-    
-    i = bucketVector_[bucketNum].Includes(e);
-
-    if (i == bucketVector_[bucketNum].End())
-      i = bucketVector_[bucketNum].Insert(e);
+    size_t b;
+    return Construct(b, key)->value_.data_;
+  }
 
-    return (*i).data_;
+  template <typename K, typename D, class H, class P, class A>
+  D& HashTable<K,D,H,P,A>::Get (K&& key)
+  {
+    size_t b;
+    return Construct(b, std::move(key))->value_.data_;
   }
 
-  template <typename K, typename D, class H>
-  void HashTable<K,D,H>::Put (const K& key, const D& data)
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::Put (const K& key, const D& data)
   {
     Get(key) = data;
   }
 
-  template <typename K, typename D, class H>
-  D& HashTable<K,D,H>::operator[] (const K& key)
+  template <typename K, typename D, class H, class P, class A>
+  D& HashTable<K,D,H,P,A>::operator[] (const K& key)
   {
     return Get(key);
   }
 
+  template <typename K, typename D, class H, class P, class A>
+  template <class I>
+  void HashTable<K,D,H,P,A>::BulkLoad (I first, I last, DuplicatePolicy policy, bool presize)
+  {
+    size_t n = 0, k, b, j;
+    I i;
+
+    // pass 0: count and presize
+    for (i = first; i != last; ++i)
+      ++n;
+    if (n == 0)
+      return;
+    if (Migrating())
+      Migrate(oldNumBuckets_);
+    if (presize && numBuckets_ < Size() + n)
+      Rehash(Size() + n);
+
+    // pass 1: bucket of each entry, and start of each bucket's group
+    Vector < size_t > bucket(n), start(numBuckets_ + 1);
+    Vector < const EntryType* > sorted(n);
+    for (b = 0; b <= numBuckets_; ++b)
+      start[b] = 0;
+    for (i = first, k = 0; i != last; ++i, ++k)
+    {
+      bucket[k] = Index((*i).key_);
+      ++start[bucket[k] + 1];
+    }
+    for (b = 0; b < numBuckets_; ++b)
+      start[b + 1] += start[b];
+
+    // pass 2: place entries in their groups (stable, so input order is kept)
+    for (i = first, k = 0; i != last; ++i, ++k)
+      sorted[start[bucket[k]]++] = &(*i);
+    // start[b] is now the end of group b, which begins at start[b - 1]
+
+    // insert each group in input order: a key already in the bucket, from
+    // before the load or earlier in the group, takes the data for keepLast
+    Node** link;
+    for (b = 0, j = 0; b < numBuckets_; ++b)
+    {
+      for ( ; j < start[b]; ++j)
+      {
+        const EntryType* e = sorted[j];
+        link = bucketVector_[b].Find(e->key_);
+        if (*link != 0)
+        {
+          if (policy == keepLast)
+            (*link)->value_.data_ = e->data_;
+          continue;
+        }
+        bucketVector_[b].PushFront(NewNode(EntryType(*e)));
+        ++size_;
+        Occupy(b);
+      }
+    }
+  }
+
   // constructors
 
-  template <typename K, typename D, class H>
-  HashTable <K,D,H>::HashTable (size_t n, bool prime)
-    :  numBuckets_(n), bucketVector_(0), hashObject_()
+  template <typename K, typename D, class H, class P, class A>
+  HashTable <K,D,H,P,A>::HashTable (size_t n, bool prime)
+    :  numBuckets_(n), bucketVector_(0), hashObject_(), size_(0), occupied_(0),
+       firstOccupied_(0), oldNumBuckets_(0), oldVector_(0), migrateNext_(0),
+       maxLoad_(0), minLoad_(0), resizeCount_(0), alloc_()
   {
-    // ensure at least 2 buckets
-    if (numBuckets_ < 3)
-      numBuckets_ = 2;
-    // optionally convert to prime number of buckets
-    if (prime)
-      numBuckets_ = fsu::PrimeBelow(numBuckets_);
+    // at least 2 buckets, prime (optionally) or as the policy requires
+    numBuckets_ = P::Buckets(numBuckets_, prime);
     bucketVector_.SetSize(numBuckets_);
+    InitOccupied();
+#ifdef HASHTBL_PROBE_COUNT
+    searches_ = 0;
+    probes_ = 0;
+#endif
   }
 
-  template <typename K, typename D, class H>
-  HashTable <K,D,H>::HashTable (size_t n, H hashObject, bool prime)
-    :  numBuckets_(n), bucketVector_(0), hashObject_(hashObject)
+  template <typename K, typename D, class H, class P, class A>
+  HashTable <K,D,H,P,A>::HashTable (size_t n, H hashObject, bool prime)
+    :  numBuckets_(n), bucketVector_(0), hashObject_(hashObject), size_(0), occupied_(0),
+       firstOccupied_(0), oldNumBuckets_(0), oldVector_(0), migrateNext_(0),
+       maxLoad_(0), minLoad_(0), resizeCount_(0), alloc_()
   {
-    // ensure at least 2 buckets
-    if (numBuckets_ < 3)
-      numBuckets_ = 2;
-    // optionally convert to prime number of buckets
-    if (prime)
-      numBuckets_ = fsu::PrimeBelow(numBuckets_);
+    // at least 2 buckets, prime (optionally) or as the policy requires
+    numBuckets_ = P::Buckets(numBuckets_, prime);
     bucketVector_.SetSize(numBuckets_);
+    InitOccupied();
+#ifdef HASHTBL_PROBE_COUNT
+    searches_ = 0;
+    probes_ = 0;
+#endif
   }
 
   // other public methods
 
-  template <typename K, typename D, class H>
-  HashTable <K,D,H>::~HashTable ()
+  template <typename K, typename D, class H, class P, class A>
+  HashTable <K,D,H,P,A>::~HashTable ()
   {
     Clear();
   }
 
-  template <typename K, typename D, class H>
-  void HashTable<K,D,H>::Rehash (size_t nb)
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::Rehash (size_t nb, bool incremental)
   {
+    if (Migrating())
+      Migrate(oldNumBuckets_);
     if (nb == 0) nb = Size();
-    HashTable<K,D,H> newTable(nb,hashObject_);
-    for (size_t i = 0; i < numBuckets_; ++i)
-    {
-      while (!bucketVector_[i].Empty()) // pop as we go saves local space bloat
-      {
-        newTable.Insert(bucketVector_[i].Back().key_,bucketVector_[i].Back().data_);
-        bucketVector_[i].PopBack();
-      }
-    }
-    fsu::Swap(numBuckets_,newTable.numBuckets_);
-    bucketVector_.Swap(newTable.bucketVector_);
+    nb = P::Buckets(nb, 1);
+
+    // current buckets become the old buckets, to be drained into new ones
+    oldVector_.Swap(bucketVector_);
+    oldNumBuckets_ = numBuckets_;
+    migrateNext_ = 0;
+    numBuckets_ = nb;
+    bucketVector_.SetSize(numBuckets_);
+    InitOccupied();
+
+    if (!incremental)
+      Migrate(oldNumBuckets_);
   }
 
-  template <typename K, typename D, class H>
-  void HashTable<K,D,H>::Clear ()
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::SetLoadFactors (double maxLoad, double minLoad)
   {
-    for (size_t i = 0; i < numBuckets_; ++i)
-      bucketVector_[i].Clear();
+    if (maxLoad < 0)
+      maxLoad = 0;
+    if (minLoad > maxLoad / 2)
+      minLoad = maxLoad / 2;
+    maxLoad_ = maxLoad;
+    minLoad_ = minLoad;
   }
 
-  template <typename K, typename D, class H>
-  HashTableIterator<K,D,H> HashTable<K,D,H>::Begin () const
+  template <typename K, typename D, class H, class P, class A>
+  double HashTable<K,D,H,P,A>::LoadFactor () const
   {
-    // fsu::debug("Begin()");
-    HashTableIterator<K,D,H> i;
-    i.tablePtr_ = this;
-    i.bucketNum_ = 0;
-    while (i.bucketNum_ < numBuckets_ && bucketVector_[i.bucketNum_].Empty())
-      ++i.bucketNum_;
-    // now we either have the first non-empty bucket or we've exhausted the bucket numbers
-    if (i.bucketNum_ < numBuckets_)
-      i.bucketItr_ = bucketVector_[i.bucketNum_].Begin();
-    else
+    return (double)size_ / numBuckets_;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable<K,D,H,P,A>::ResizeCount () const
+  {
+    return resizeCount_;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTable<K,D,H,P,A>::Migrating () const
+  {
+    return oldNumBuckets_ != 0;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::Clear ()
+  {
+    // an allocator that releases all nodes at once leaves nothing to do
+    // per node unless the entries have destructors to run
+    bool visit = !A::releasesAll || !std::is_trivially_destructible<EntryType>::value;
+    for (size_t i = NextOccupied(0); i < numBuckets_; i = NextOccupied(i + 1))
     {
-      i.bucketNum_ = 0;
-      i.bucketItr_ = bucketVector_[i.bucketNum_].End();
+      Node* chain = bucketVector_[i].Release();
+      if (visit)
+        DeleteChain(chain);
     }
+    if (Migrating())
+    {
+      if (visit)
+        for (size_t i = migrateNext_; i < oldNumBuckets_; ++i)
+          DeleteChain(oldVector_[i].Release());
+      Vector < BucketType > none(0);
+      oldVector_.Swap(none);
+      oldNumBuckets_ = 0;
+      migrateNext_ = 0;
+    }
+    alloc_.Release();
+    size_ = 0;
+    InitOccupied();
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::Begin () const
+  {
+    // fsu::debug("Begin()");
+    HashTableIterator<K,D,H,P,A> i;
+    i.tablePtr_ = this;
+    // the first non-empty bucket is at or after firstOccupied_; finding it
+    // raises the bound, so repeated calls do not rescan the empty buckets
+    i.bucketNum_ = firstOccupied_ = NextBucket(firstOccupied_);
+    // now we either have the first non-empty bucket or the table is empty
+    if (i.bucketNum_ < numBuckets_ + oldNumBuckets_)
+      i.bucketItr_ = Bucket(i.bucketNum_).Begin();
     return i;
   }
 
-  template <typename K, typename D, class H>
-  HashTableIterator<K,D,H> HashTable<K,D,H>::End () const
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable<K,D,H,P,A>::End () const
   {
     // fsu::debug("End()");
-    HashTableIterator<K,D,H> i;
+    // sentinel: past the last bucket, so not Valid(); all invalid
+    // iterators compare equal, including one run off the last bucket
+    HashTableIterator<K,D,H,P,A> i;
     i.tablePtr_ = this;
-    i.bucketNum_ = numBuckets_ - 1;;
-    while ((bucketVector_[i.bucketNum_].Empty()) && (i.bucketNum_ > 0))
-      --i.bucketNum_;
-    // now either i.bucketNum_ is the last non-empty bucket or i.bucketNum_ is 0
-    i.bucketItr_ = bucketVector_[i.bucketNum_].End();
+    i.bucketNum_ = numBuckets_ + oldNumBuckets_;
     return i;
   }
 
-  template <typename K, typename D, class H>
-  size_t HashTable<K,D,H>::Size () const
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable<K,D,H,P,A>::Size () const
   {
-    size_t size(0);
-    for (size_t i = 0; i < numBuckets_; ++i)
-      size += bucketVector_[i].Size();
-    return size;
+    return size_;
   }
 
-  template <typename K, typename D, class H>
-  bool HashTable<K,D,H>::Empty () const
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable<K,D,H,P,A>::NumBuckets () const
   {
-    for (size_t i = 0; i < numBuckets_; ++i)
-      if (!bucketVector_[i].Empty())
-        return 0;
-    return 1;
+    return numBuckets_;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable<K,D,H,P,A>::BucketSize (size_t b) const
+  {
+    return bucketVector_[b].Size();
   }
 
-  template <typename K, typename D, class H>
-  void HashTable<K,D,H>::Dump (std::ostream& os, int c1, int c2) const
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable<K,D,H,P,A>::Footprint () const
+  {
+    // bucket heads and bitmap, plus the nodes (entry, one link)
+    return (numBuckets_ + oldNumBuckets_) * sizeof(BucketType)
+         + occupied_.Size() * sizeof(uint64_t)
+         + alloc_.Footprint();
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTable<K,D,H,P,A>::Empty () const
+  {
+    return size_ == 0;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable<K,D,H,P,A>::MaxBucketSize () const
+  {
+    size_t max = 0, b;
+    for (b = NextBucket(0); b < numBuckets_ + oldNumBuckets_; b = NextBucket(b + 1))
+      if (Bucket(b).Size() > max)
+        max = Bucket(b).Size();
+    return max;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::Analysis (std::ostream& os) const
+  {
+    const size_t histSize = 16;     // last entry counts chains this long or longer
+    size_t count[histSize] = { 0 };
+    size_t b, len, max = 0, nonEmpty = 0;
+    double hitProbes = 0, missProbes = 0;
+
+    // buckets in use: the new ones, plus unmigrated old ones
+    size_t buckets = numBuckets_ + oldNumBuckets_ - migrateNext_;
+    for (b = NextBucket(0); b < numBuckets_ + oldNumBuckets_; b = NextBucket(b + 1))
+    {
+      len = Bucket(b).Size();
+      ++nonEmpty;
+      ++count[len < histSize ? len : histSize - 1];
+      if (len > max) max = len;
+      hitProbes += len * (len + 1) / 2.0;   // finding each entry in turn
+      missProbes += (double)len * len;      // absent key hashed like the entries
+    }
+    count[0] = buckets - nonEmpty;
+
+    double alpha = (double)size_ / buckets;
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::dec << std::fixed << std::setprecision(3)
+       << "  table size:              " << size_ << '\n'
+       << "  number of buckets:       " << buckets;
+    if (Migrating())
+      os << " (" << oldNumBuckets_ - migrateNext_ << " old, migrating)";
+    os << '\n'
+       << "  load factor:             " << alpha << '\n'
+       << "  empty buckets:           " << count[0]
+       << " (" << 100.0 * count[0] / buckets << "%)\n"
+       << "  max bucket size:         " << max << '\n'
+       << "  chain length histogram:\n";
+    for (len = 0; len < histSize; ++len)
+      if (count[len] > 0)
+        os << "    " << std::setw(6) << len << (len + 1 == histSize ? "+ " : "  ")
+           << std::setw(10) << count[len] << '\n';
+    os << "  probes per search        expected   actual\n"
+       << "    key present:           " << std::setw(8) << 1 + alpha / 2
+       << std::setw(9) << (size_ ? hitProbes / size_ : 0.0) << '\n'
+       << "    key absent:            " << std::setw(8) << 1 + alpha
+       << std::setw(9) << (size_ ? missProbes / size_ : 0.0) << '\n';
+#ifdef HASHTBL_PROBE_COUNT
+    size_t searches = searches_.load(std::memory_order_relaxed);
+    size_t probes = probes_.load(std::memory_order_relaxed);
+    os << "  counted searches:        " << searches << '\n'
+       << "  counted probes:          " << probes
+       << " (" << (searches ? (double)probes / searches : 0.0) << " per search)\n";
+#endif
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable<K,D,H,P,A>::Dump (std::ostream& os, int c1, int c2) const
   {
     typename BucketType::ConstIterator i;
+    size_t next = NextOccupied(0);
     for (size_t b = 0; b < numBuckets_; ++b)
     {
       os << "b[" << b << "]:";
-      for (i = bucketVector_[b].Begin(); i != bucketVector_[b].End(); ++i)
+      if (b == next) // empty buckets are only labeled
+      {
+        for (i = bucketVector_[b].Begin(); i != bucketVector_[b].End(); ++i)
+          os << '\t' << std::setw(c1) << (*i).key_ << ':' << std::setw(c2) << (*i).data_;
+        next = NextOccupied(b + 1);
+      }
+      os << '\n';
+    }
+    for (size_t b = migrateNext_; b < oldNumBuckets_; ++b)
+    {
+      os << "old b[" << b << "]:";
+      for (i = oldVector_[b].Begin(); i != oldVector_[b].End(); ++i)
         os << '\t' << std::setw(c1) << (*i).key_ << ':' << std::setw(c2) << (*i).data_;
       os << '\n';
     }
   }
 
-  // private helper
+  // private helpers
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable <K,D,H,P,A>::Index (const K& k) const
+  {
+    return P::Reduce(hashObject_ (k), numBuckets_);
+  }
+
+#ifdef HASHTBL_PROBE_COUNT
+  template <typename K, typename D, class H, class P, class A>
+  template <class Q>
+  typename HashTable <K,D,H,P,A>::BucketType::ConstIterator
+  HashTable <K,D,H,P,A>::Search (const BucketType& bucket, const Q& k, size_t& probes) const
+  // Includes(), counting the entries examined
+  {
+    typename BucketType::ConstIterator i;
+    for (i = bucket.Begin(); i != bucket.End(); ++i)
+    {
+      ++probes;
+      if ((*i).key_ == k)
+        break;
+    }
+    return i;
+  }
+#endif
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable <K,D,H,P,A>::Home (const K& k) const
+  {
+    return HomeOf(hashObject_ (k));
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable <K,D,H,P,A>::HomeOf (size_t h) const
+  {
+    if (oldNumBuckets_ != 0)
+    {
+      size_t b = P::Reduce(h, oldNumBuckets_);
+      if (b >= migrateNext_)
+        return numBuckets_ + b;
+    }
+    return P::Reduce(h, numBuckets_);
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  typename HashTable <K,D,H,P,A>::BucketType& HashTable <K,D,H,P,A>::Bucket (size_t b)
+  {
+    return (b < numBuckets_) ? bucketVector_[b] : oldVector_[b - numBuckets_];
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  const typename HashTable <K,D,H,P,A>::BucketType& HashTable <K,D,H,P,A>::Bucket (size_t b) const
+  {
+    return (b < numBuckets_) ? bucketVector_[b] : oldVector_[b - numBuckets_];
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable <K,D,H,P,A>::NextBucket (size_t b) const
+  {
+    if (b < numBuckets_)
+    {
+      b = NextOccupied(b);
+      if (b < numBuckets_ || oldNumBuckets_ == 0)
+        return b;
+    }
+    // old buckets have no bitmap, but only the unmigrated ones are scanned
+    if (b < numBuckets_ + migrateNext_)
+      b = numBuckets_ + migrateNext_;
+    while (b < numBuckets_ + oldNumBuckets_ && oldVector_[b - numBuckets_].Empty())
+      ++b;
+    return b;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::Migrate (size_t count)
+  {
+    size_t b;
+    Node *node, *next;
+    for ( ; count > 0 && migrateNext_ < oldNumBuckets_; --count, ++migrateNext_)
+    {
+      // relink each node; keys are distinct, so no Find search
+      for (node = oldVector_[migrateNext_].Release(); node != 0; node = next)
+      {
+        next = node->next_;
+        b = Index(node->value_.key_);
+        bucketVector_[b].PushFront(node);
+        Occupy(b);
+      }
+    }
+    if (migrateNext_ == oldNumBuckets_)
+    {
+      Vector < BucketType > none(0);
+      oldVector_.Swap(none);
+      oldNumBuckets_ = 0;
+      migrateNext_ = 0;
+      if (firstOccupied_ > numBuckets_)  // it pointed past the old buckets
+        firstOccupied_ = numBuckets_;
+    }
+  }
 
-  template <typename K, typename D, class H>
-  size_t HashTable <K,D,H>::Index (const K& k) const
+  template <typename K, typename D, class H, class P, class A>
+  template <class Q>
+  typename HashTable <K,D,H,P,A>::BucketType::ConstIterator
+  HashTable <K,D,H,P,A>::Lookup (const Q& q, size_t& bucketNum) const
   {
-    return hashObject_ (k) % numBuckets_;
+    bucketNum = HomeOf(hashObject_(q));
+#ifdef HASHTBL_PROBE_COUNT
+    size_t probes = 0;
+    typename BucketType::ConstIterator i = Search(Bucket(bucketNum), q, probes);
+    searches_.fetch_add(1, std::memory_order_relaxed);
+    probes_.fetch_add(probes, std::memory_order_relaxed);
+    return i;
+#else
+    return Bucket(bucketNum).Includes(q);
+#endif
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  template <class Q>
+  bool HashTable <K,D,H,P,A>::Erase (const Q& q)
+  {
+    if (Migrating())
+      Migrate(migrateStep);
+    size_t bucketNum = HomeOf(hashObject_(q));
+    Node** link = Bucket(bucketNum).Find(q);
+
+    if (*link == 0)
+      return false;
+    DeleteNode(Bucket(bucketNum).Unlink(link));
+    --size_;
+    Vacate(bucketNum);
+    if (maxLoad_ > 0 && !Migrating())
+      Resize();
+    return true;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  template <class KK, class DD>
+  typename HashTable <K,D,H,P,A>::Node* HashTable <K,D,H,P,A>::Store (size_t& bucketNum, KK&& k, DD&& d)
+  // Insert: k and d are copied or moved only into a new node
+  {
+    if (Migrating())
+      Migrate(migrateStep);
+    bucketNum = Home(k);
+    Node** link = Bucket(bucketNum).Find(k);
+
+    if (*link == 0)
+      return Link(bucketNum, NewNode(EntryType(std::forward<KK>(k), std::forward<DD>(d))));
+    (*link)->value_.data_ = std::forward<DD>(d);
+    return *link;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  template <class KK, typename... Args>
+  typename HashTable <K,D,H,P,A>::Node* HashTable <K,D,H,P,A>::Construct (size_t& bucketNum, KK&& k, Args&&... args)
+  // Emplace and Get: D(args...) is built only for a new entry
+  {
+    if (Migrating())
+      Migrate(migrateStep);
+    bucketNum = Home(k);
+    Node** link = Bucket(bucketNum).Find(k);
+
+    if (*link == 0)
+      return Link(bucketNum, NewNode(EntryType(std::forward<KK>(k), D(std::forward<Args>(args)...))));
+    return *link;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  typename HashTable <K,D,H,P,A>::Node* HashTable <K,D,H,P,A>::Link (size_t& bucketNum, Node* node)
+  {
+    Bucket(bucketNum).PushFront(node);
+    ++size_;
+    Occupy(bucketNum);
+    if (maxLoad_ > 0 && !Migrating())
+    {
+      // the node may be relinked into a new bucket, but does not move
+      Resize();
+      if (Migrating())
+        bucketNum = Home(node->value_.key_);
+    }
+    return node;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A> HashTable <K,D,H,P,A>::MakeIterator (size_t bucketNum, const Node* node) const
+  {
+    HashTableIterator<K,D,H,P,A> i;
+    i.tablePtr_ = this;
+    i.bucketNum_ = bucketNum;
+    i.bucketItr_ = typename BucketType::ConstIterator(node);
+    return i;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  typename HashTable <K,D,H,P,A>::Node* HashTable <K,D,H,P,A>::NewNode (EntryType&& e)
+  {
+    return new (alloc_.Allocate(sizeof(Node))) Node(std::move(e));
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::DeleteNode (Node* n)
+  {
+    n->~Node();
+    alloc_.Deallocate(n, sizeof(Node));
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::DeleteChain (Node* n)
+  {
+    Node* next;
+    for ( ; n != 0; n = next)
+    {
+      next = n->next_;
+      if (A::releasesAll)
+        n->~Node();
+      else
+        DeleteNode(n);
+    }
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::Resize ()
+  {
+    if (size_ > maxLoad_ * numBuckets_)
+    {
+      ++resizeCount_;
+      Rehash(P::Grow(numBuckets_), 1);
+    }
+    else if (size_ < minLoad_ * numBuckets_ && numBuckets_ > 2)
+    {
+      ++resizeCount_;
+      Rehash(numBuckets_ / 2, 1);
+    }
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::InitOccupied ()
+  {
+    occupied_.SetSize((numBuckets_ + 63) / 64);
+    for (size_t w = 0; w < occupied_.Size(); ++w)
+      occupied_[w] = 0;
+    firstOccupied_ = 0;
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::Occupy (size_t b)
+  // b may be an old bucket (numBuckets_ + j), which has no bit
+  {
+    if (b < firstOccupied_)
+      firstOccupied_ = b;
+    if (b < numBuckets_)
+      occupied_[b >> 6] |= (uint64_t)1 << (b & 63);
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  void HashTable <K,D,H,P,A>::Vacate (size_t b)
+  {
+    if (b < numBuckets_ && bucketVector_[b].Empty())
+      occupied_[b >> 6] &= ~((uint64_t)1 << (b & 63));
+  }
+
+  template <typename K, typename D, class H, class P, class A>
+  size_t HashTable <K,D,H,P,A>::NextOccupied (size_t b) const
+  {
+    size_t w = b >> 6;
+    if (w >= occupied_.Size())
+      return numBuckets_;
+    uint64_t bits = occupied_[w] & (~(uint64_t)0 << (b & 63));
+    while (bits == 0)
+    {
+      if (++w == occupied_.Size())
+        return numBuckets_;
+      bits = occupied_[w];
+    }
+    return (w << 6) + fsu::LowestBit(bits);
   }
 
   //--------------------------------------------
-  //     HashTableIterator <K,D,H>
+  //     HashTableIterator <K,D,H,P,A>
   //--------------------------------------------
 
-  template <typename K, typename D, class H>
-  HashTableIterator<K,D,H>::HashTableIterator ()
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A>::HashTableIterator ()
     :  tablePtr_(0), bucketNum_(0), bucketItr_()
   {}
 
-  template <typename K, typename D, class H>
-  HashTableIterator<K,D,H>::HashTableIterator (const Iterator& i)
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator<K,D,H,P,A>::HashTableIterator (const Iterator& i)
     :  tablePtr_(i.tablePtr_), bucketNum_(i.bucketNum_), bucketItr_(i.bucketItr_)
   {}
 
-  template <typename K, typename D, class H>
-  HashTableIterator <K,D,H>& HashTableIterator<K,D,H>::operator = (const Iterator& i)
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator <K,D,H,P,A>& HashTableIterator<K,D,H,P,A>::operator = (const Iterator& i)
   {
     if (this != &i)
     {
@@ -417,8 +1113,8 @@ namespace fsu
     return *this;
   }
 
-  template <typename K, typename D, class H>
-  HashTableIterator <K,D,H>& HashTableIterator<K,D,H>::operator ++ ()
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator <K,D,H,P,A>& HashTableIterator<K,D,H,P,A>::operator ++ ()
   {
     size_t num;
 
@@ -429,29 +1125,26 @@ namespace fsu
     ++bucketItr_;
 
     // if bucket itr is not at the end of the bucket, return itr
-    if (bucketItr_ != tablePtr_->bucketVector_[bucketNum_].End())
+    if (bucketItr_ != tablePtr_->Bucket(bucketNum_).End())
       return *this;
 
     // start at beginning of next non-empty bucket and return itr
-    num = bucketNum_ + 1;
+    num = tablePtr_->NextBucket(bucketNum_ + 1);
 
-    while (num < tablePtr_->numBuckets_ && tablePtr_->bucketVector_[num].Empty())
-      ++num;
-    
     // if we found non-empty bucket
-    if (num < tablePtr_->numBuckets_)
+    if (num < tablePtr_->numBuckets_ + tablePtr_->oldNumBuckets_)
     {
       bucketNum_ = num;
-      bucketItr_ = tablePtr_->bucketVector_[num].Begin();
+      bucketItr_ = tablePtr_->Bucket(num).Begin();
     }
 
     return *this;
   }
 
-  template <typename K, typename D, class H>
-  HashTableIterator <K,D,H> HashTableIterator<K,D,H>::operator ++ (int)
+  template <typename K, typename D, class H, class P, class A>
+  HashTableIterator <K,D,H,P,A> HashTableIterator<K,D,H,P,A>::operator ++ (int)
   {
-    HashTableIterator <K,D,H> i = *this;
+    HashTableIterator <K,D,H,P,A> i = *this;
     operator ++();
     return i;
   }
@@ -461,8 +1154,8 @@ namespace fsu
      (2) adding Begin() and End() support
      (3) adding this non-const dereference
 
-  template <typename K, typename D, class H>
-  Entry<K,D>& HashTableIterator<K,D,H>::operator * ()
+  template <typename K, typename D, class H, class P, class A>
+  Entry<K,D>& HashTableIterator<K,D,H,P,A>::operator * ()
   {
     if (!Valid())
     {
@@ -473,8 +1166,8 @@ namespace fsu
   }
   */
 
-  template <typename K, typename D, class H>
-  const Entry<K,D>& HashTableIterator<K,D,H>::operator * () const
+  template <typename K, typename D, class H, class P, class A>
+  const Entry<K,D>& HashTableIterator<K,D,H,P,A>::operator * () const
   {
     if (!Valid())
     {
@@ -484,8 +1177,8 @@ namespace fsu
     return *bucketItr_;
   }
 
-  template <typename K, typename D, class H>
-  bool HashTableIterator<K,D,H>::operator == (const Iterator& i2) const
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTableIterator<K,D,H,P,A>::operator == (const Iterator& i2) const
   {
     if (!Valid() && !i2.Valid())
       return 1;
@@ -504,18 +1197,18 @@ namespace fsu
     return 1;
   }
 
-  template <typename K, typename D, class H>
-  bool HashTableIterator<K,D,H>::operator != (const Iterator& i2) const
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTableIterator<K,D,H,P,A>::operator != (const Iterator& i2) const
   {
     return !(*this == i2);
   }
 
-  template <typename K, typename D, class H>
-  bool HashTableIterator<K,D,H>::Valid () const
+  template <typename K, typename D, class H, class P, class A>
+  bool HashTableIterator<K,D,H,P,A>::Valid () const
   {
     if (tablePtr_ == 0)
       return 0;
-    if (bucketNum_ >= tablePtr_->numBuckets_)
+    if (bucketNum_ >= tablePtr_->numBuckets_ + tablePtr_->oldNumBuckets_)
       return 0;
     return bucketItr_.Valid();
   }
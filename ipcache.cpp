@@ -0,0 +1,60 @@
+/*
+    ipcache.cpp
+    contains RouteCache implementations
+*/
+
+#include <ipcache.h>
+
+RouteCache::RouteCache (size_t sets)
+  : sets_(), shift_(32), filled_(1), generation_(0), hits_(0), misses_(0)
+{
+  size_t n = 1;
+  while (n < sets)
+  {
+    n <<= 1;
+    --shift_;
+  }
+  sets_.resize(n);
+  Invalidate();
+}
+
+void RouteCache::Invalidate ()
+{
+  if (!filled_)
+    return;
+  for (size_t i = 0; i < sets_.size(); ++i)
+  {
+    sets_[i].valid_ = 0;
+    sets_[i].lru_ = 0;
+  }
+  filled_ = 0;
+}
+
+void RouteCache::Revalidate (uint64_t generation)
+{
+  if (generation != generation_)
+  {
+    Invalidate();
+    generation_ = generation;
+  }
+}
+
+size_t RouteCache::Sets () const
+{
+  return sets_.size();
+}
+
+uint64_t RouteCache::Hits () const
+{
+  return hits_;
+}
+
+uint64_t RouteCache::Misses () const
+{
+  return misses_;
+}
+
+void RouteCache::ResetCounts ()
+{
+  hits_ = misses_ = 0;
+}
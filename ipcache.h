@@ -0,0 +1,123 @@
+/*
+    ipcache.h
+    contains RouteCache class definition
+
+    Defining the RouteCache class, a small cache of resolved routes for
+    RouteTable::Go(). Message traffic is skewed toward a few thousand
+    destinations, and a cached destination skips the table lookup and
+    the interpretation of its route.
+
+    The cache is 2-way set associative with a power of two number of
+    sets, the set taken from the high bits of the destination times
+    2^32/phi. Each way holds a destination and its RouteResult: whether
+    a route was found and, if so, the route, its class letter, netID and
+    hostID. Destinations with no table entry are cached as well. The
+    least recently used way of a set is replaced.
+
+    A set is 44 bytes, so the default 1024 sets take 44K and stay in L2.
+
+    Invalidate() empties the cache. It costs one pass over the sets the
+    first time after the cache has been filled and nothing after that,
+    so a Load() that inserts entry by entry pays for it once.
+
+    Revalidate(generation) invalidates the cache if it was filled from
+    routes of another generation (see RouteTable::RouteVersion), which is
+    how a Go() thread notices that the routes have changed.
+
+    A RouteCache is not shared between threads: Go() keeps one per
+    worker thread.
+*/
+
+#ifndef _IPCACHE_H
+#define _IPCACHE_H
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include <ipnum.h>
+
+struct RouteResult
+{
+  ipNumber route_;
+  ipNumber netID_;
+  ipNumber hostID_;
+  char     class_;   // 'A', 'B', 'C', 'D' (see ipLetter)
+  bool     found_;
+} ;
+
+class RouteCache
+{
+public:
+
+  bool     Find       (ipNumber dN, RouteResult& result);
+  // return:  true on a hit, with result set
+
+  void     Store      (ipNumber dN, const RouteResult& result);
+  void     Invalidate ();
+  void     Revalidate (uint64_t generation);
+
+  size_t   Sets       () const;
+  uint64_t Hits       () const;
+  uint64_t Misses     () const;
+  void     ResetCounts();
+
+  explicit RouteCache (size_t sets = defaultSets);
+  // sets is rounded up to a power of two
+
+  static const size_t defaultSets = 1024;
+
+private:
+
+  struct Set
+  {
+    ipNumber     dest_[2];
+    RouteResult  result_[2];
+    uint8_t      valid_;   // bit w: way w in use
+    uint8_t      lru_;     // the way to replace next
+  } ;
+
+  std::vector<Set>  sets_;
+  unsigned          shift_;  // 32 - log2(number of sets)
+  bool              filled_; // something stored since the last Invalidate()
+  uint64_t          generation_;
+  uint64_t          hits_;
+  uint64_t          misses_;
+
+  size_t Index (ipNumber dN) const
+  {
+    return shift_ < 32 ? (size_t)((uint32_t)(dN * 0x9E3779B1u) >> shift_) : 0;
+  }
+} ;
+
+inline bool RouteCache::Find (ipNumber dN, RouteResult& result)
+{
+  Set& s = sets_[Index(dN)];
+  for (unsigned w = 0; w < 2; ++w)
+  {
+    if ((s.valid_ & (1 << w)) && s.dest_[w] == dN)
+    {
+      result = s.result_[w];
+      s.lru_ = (uint8_t)(1 - w);
+      ++hits_;
+      return 1;
+    }
+  }
+  ++misses_;
+  return 0;
+}
+
+inline void RouteCache::Store (ipNumber dN, const RouteResult& result)
+{
+  Set& s = sets_[Index(dN)];
+  unsigned w = s.lru_;
+  if ((s.valid_ & (1 << (1 - w))) && s.dest_[1 - w] == dN) // already there
+    w = 1 - w;
+  s.dest_[w] = dN;
+  s.result_[w] = result;
+  s.valid_ |= (uint8_t)(1 << w);
+  s.lru_ = (uint8_t)(1 - w);
+  filled_ = 1;
+}
+
+#endif
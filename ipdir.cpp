@@ -0,0 +1,223 @@
+/*
+    ipdir.cpp
+    contains DirTable implementations
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <ipdir.h>
+#include <hashpolicy.h> // FSU_PREFETCH
+
+void DirTable::LookupBatch (const ipNumber* address, ipNumber* route, uint8_t* found, size_t n) const
+{
+  const size_t groupSize = 16;
+  uint32_t e[groupSize];
+
+  for (size_t base = 0; base < n; base += groupSize)
+  {
+    size_t m = (n - base < groupSize) ? n - base : groupSize, j;
+    for (j = 0; j < m; ++j)
+      FSU_PREFETCH(&tbl24_[address[base + j] >> 8]);
+    for (j = 0; j < m; ++j)
+    {
+      e[j] = tbl24_[address[base + j] >> 8];
+      if (e[j] >= extended)
+        FSU_PREFETCH(&tbl8_[((size_t)(e[j] & ~extended) << 8) | (address[base + j] & 0xFF)]);
+    }
+    for (j = 0; j < m; ++j)
+    {
+      if (e[j] >= extended)
+        e[j] = tbl8_[((size_t)(e[j] & ~extended) << 8) | (address[base + j] & 0xFF)];
+      route[base + j] = e[j];
+      found[base + j] = (e[j] != 0);
+    }
+  }
+} // end DirTable::LookupBatch()
+
+void DirTable::Insert (ipNumber prefix, uint32_t len, ipNumber route)
+{
+  size_t i, b;
+
+  if (len <= 24)
+  {
+    size_t start = prefix >> 8, count = (size_t)1 << (24 - len);
+    for (i = start; i < start + count; ++i)
+    {
+      if (tbl24_[i] >= extended)
+      {
+        b = tbl24_[i] & ~extended;
+        SetRange(tbl8_ + b * blockSize, tbl8Len_ + b * blockSize, blockSize, route, len);
+        if (tbl24Len_[i] <= len)
+          tbl24Len_[i] = (uint8_t)len;
+      }
+      else
+        SetRange(tbl24_ + i, tbl24Len_ + i, 1, route, len);
+    }
+    return;
+  }
+
+  // prefixes longer than /24 live in a tbl8 block
+  i = prefix >> 8;
+  if (tbl24_[i] < extended)
+    tbl24_[i] = extended | NewBlock(tbl24_[i], tbl24Len_[i]);
+  b = tbl24_[i] & ~extended;
+  SetRange(tbl8_ + b * blockSize + (prefix & 0xFF), tbl8Len_ + b * blockSize + (prefix & 0xFF),
+           (size_t)1 << (32 - len), route, len);
+} // end DirTable::Insert()
+
+void DirTable::Remove (ipNumber prefix, uint32_t len, ipNumber replRoute, uint32_t replLen)
+{
+  size_t i, b;
+
+  if (len <= 24)
+  {
+    size_t start = prefix >> 8, count = (size_t)1 << (24 - len);
+    for (i = start; i < start + count; ++i)
+    {
+      if (tbl24_[i] >= extended)
+      {
+        b = tbl24_[i] & ~extended;
+        ResetRange(tbl8_ + b * blockSize, tbl8Len_ + b * blockSize, blockSize,
+                   len, replRoute, replLen);
+        if (tbl24Len_[i] == len)
+          tbl24Len_[i] = (uint8_t)replLen;
+      }
+      else
+        ResetRange(tbl24_ + i, tbl24Len_ + i, 1, len, replRoute, replLen);
+    }
+    return;
+  }
+
+  i = prefix >> 8;
+  if (tbl24_[i] < extended)
+    return;
+  b = tbl24_[i] & ~extended;
+  ResetRange(tbl8_ + b * blockSize + (prefix & 0xFF), tbl8Len_ + b * blockSize + (prefix & 0xFF),
+             (size_t)1 << (32 - len), len, replRoute, replLen);
+  Collapse(i);
+} // end DirTable::Remove()
+
+void DirTable::Clear ()
+{
+  std::memset(tbl24_, 0, tbl24Size * sizeof(uint32_t));
+  std::memset(tbl24Len_, 0, tbl24Size * sizeof(uint8_t));
+  std::free(tbl8_);
+  std::free(tbl8Len_);
+  tbl8_ = 0;
+  tbl8Len_ = 0;
+  tbl8Blocks_ = 0;
+  tbl8Used_ = 0;
+  freeBlocks_.Clear();
+}
+
+size_t DirTable::Blocks () const
+{
+  return tbl8Used_ - freeBlocks_.Size();
+}
+
+size_t DirTable::Footprint () const
+{
+  return tbl24Size * (sizeof(uint32_t) + sizeof(uint8_t))
+       + tbl8Blocks_ * blockSize * (sizeof(uint32_t) + sizeof(uint8_t))
+       + freeBlocks_.Capacity() * sizeof(uint32_t);
+}
+
+DirTable::DirTable ()
+  :  tbl24_(0), tbl24Len_(0), tbl8_(0), tbl8Len_(0), tbl8Blocks_(0), tbl8Used_(0), freeBlocks_()
+{
+  // calloc leaves untouched pages of the 80MB tbl24 unmapped
+  tbl24_    = (uint32_t*) std::calloc(tbl24Size, sizeof(uint32_t));
+  tbl24Len_ = (uint8_t*)  std::calloc(tbl24Size, sizeof(uint8_t));
+  if (tbl24_ == 0 || tbl24Len_ == 0)
+  {
+    std::cerr << "** DirTable: unable to allocate tbl24\n";
+    exit (EXIT_FAILURE);
+  }
+}
+
+DirTable::~DirTable ()
+{
+  std::free(tbl24_);
+  std::free(tbl24Len_);
+  std::free(tbl8_);
+  std::free(tbl8Len_);
+}
+
+// private helpers
+
+uint32_t DirTable::NewBlock (uint32_t route, uint8_t len)
+// returns a tbl8 block with every entry set to route/len
+{
+  uint32_t b;
+  if (!freeBlocks_.Empty())
+  {
+    b = freeBlocks_.Back();
+    freeBlocks_.PopBack();
+  }
+  else
+  {
+    if (tbl8Used_ == tbl8Blocks_)
+    {
+      size_t n = (tbl8Blocks_ == 0) ? 64 : 2 * tbl8Blocks_;
+      uint32_t * t8  = (uint32_t*) std::realloc(tbl8_, n * blockSize * sizeof(uint32_t));
+      uint8_t *  t8L = (uint8_t*)  std::realloc(tbl8Len_, n * blockSize * sizeof(uint8_t));
+      if (t8 == 0 || t8L == 0)
+      {
+        std::cerr << "** DirTable: unable to allocate tbl8\n";
+        exit (EXIT_FAILURE);
+      }
+      tbl8_ = t8;
+      tbl8Len_ = t8L;
+      tbl8Blocks_ = n;
+    }
+    b = (uint32_t)tbl8Used_++;
+  }
+  for (size_t j = 0; j < blockSize; ++j)
+  {
+    tbl8_[b * blockSize + j] = route;
+    tbl8Len_[b * blockSize + j] = len;
+  }
+  return b;
+}
+
+void DirTable::SetRange (uint32_t* entry, uint8_t* entryLen, size_t count,
+                         ipNumber route, uint32_t len)
+// longer prefixes already in the range keep their entries
+{
+  for (size_t j = 0; j < count; ++j)
+  {
+    if (entryLen[j] <= len)
+    {
+      entry[j] = route;
+      entryLen[j] = (uint8_t)len;
+    }
+  }
+}
+
+void DirTable::ResetRange (uint32_t* entry, uint8_t* entryLen, size_t count,
+                           uint32_t len, ipNumber replRoute, uint32_t replLen)
+// only entries that came from the removed prefix have its length
+{
+  for (size_t j = 0; j < count; ++j)
+  {
+    if (entryLen[j] == len && entry[j] != 0)
+    {
+      entry[j] = replRoute;
+      entryLen[j] = (uint8_t)replLen;
+    }
+  }
+}
+
+void DirTable::Collapse (size_t i)
+// frees the block of tbl24 slot i once it holds no prefix longer than /24
+{
+  size_t b = tbl24_[i] & ~extended;
+  for (size_t j = 0; j < blockSize; ++j)
+    if (tbl8Len_[b * blockSize + j] > 24)
+      return;
+  // every entry now comes from the covering prefix of length <= 24
+  tbl24_[i] = tbl8_[b * blockSize];
+  tbl24Len_[i] = tbl8Len_[b * blockSize];
+  freeBlocks_.PushBack((uint32_t)b);
+}
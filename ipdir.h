@@ -0,0 +1,95 @@
+/*
+    ipdir.h
+    contains DirTable class definition
+
+    Defining the DirTable class, a DIR-24-8 flat lookup table giving a
+    forwarding decision in at most two memory reads.
+
+    tbl24 has one 32-bit entry for each of the 2^24 values of the leading
+    24 bits of an address. An entry is either 0 (no route), a route, or
+    an extended entry referring to a 256-entry tbl8 block that resolves
+    the last 8 bits of the address for /24 slots covered by prefixes
+    longer than /24.
+
+    Routes are class A, B or C ipNumbers, so they never have the top
+    three bits set; entries with those bits set are extended entries
+    whose low bits give the tbl8 block number.
+
+    Each entry has a companion length byte, used only by updates, giving
+    the length of the prefix the entry came from. Insert overwrites the
+    entries in the prefix range whose length is not greater than the new
+    prefix; Remove restores entries of exactly the removed length to a
+    replacement route supplied by the caller (the next-longest prefix
+    covering the removed one). A tbl8 block is returned to a free list
+    once no prefix longer than /24 remains in it.
+*/
+
+#ifndef _IPDIR_H
+#define _IPDIR_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <vector.h>
+
+#include <ipnum.h>
+
+class DirTable
+{
+public:
+
+  bool   Lookup    (ipNumber address, ipNumber& route) const;
+  void   LookupBatch (const ipNumber* address, ipNumber* route, uint8_t* found, size_t n) const;
+  // Lookup for n addresses, prefetching tbl24 and then tbl8 entries
+
+  void   Insert    (ipNumber prefix, uint32_t len, ipNumber route);
+  // pre:  len <= 32, prefix has no bits set beyond len,
+  //       route is not badClass
+
+  void   Remove    (ipNumber prefix, uint32_t len, ipNumber replRoute, uint32_t replLen);
+  // pre:  replRoute/replLen is the longest remaining prefix shorter than
+  //       len covering prefix (0/0 if there is none)
+
+  void   Clear     ();
+  size_t Blocks    () const;   // tbl8 blocks in use
+  size_t Footprint () const;   // bytes allocated
+
+         DirTable  ();
+         ~DirTable ();
+
+private:
+
+  static const ipNumber extended   = 0xE0000000;
+  static const size_t   tbl24Size  = 1 << 24;
+  static const size_t   blockSize  = 256;
+
+  uint32_t *  tbl24_;
+  uint8_t  *  tbl24Len_;
+  uint32_t *  tbl8_;
+  uint8_t  *  tbl8Len_;
+  size_t      tbl8Blocks_;   // blocks allocated in tbl8_
+  size_t      tbl8Used_;     // blocks handed out (incl. freed)
+  fsu::Vector < uint32_t > freeBlocks_;
+
+  uint32_t NewBlock      (uint32_t route, uint8_t len);
+  void     SetRange      (uint32_t* entry, uint8_t* entryLen, size_t count,
+                          ipNumber route, uint32_t len);
+  void     ResetRange    (uint32_t* entry, uint8_t* entryLen, size_t count,
+                          uint32_t len, ipNumber replRoute, uint32_t replLen);
+  void     Collapse      (size_t i);
+
+  // prevent copying - do not implement
+  DirTable              (const DirTable&);
+  DirTable& operator =  (const DirTable&);
+} ;
+
+inline bool DirTable::Lookup (ipNumber address, ipNumber& route) const
+{
+  uint32_t e = tbl24_[address >> 8];
+  if (e >= extended)
+    e = tbl8_[((size_t)(e & ~extended) << 8) | (address & 0xFF)];
+  route = e;
+  return e != 0;
+}
+
+#endif
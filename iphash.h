@@ -0,0 +1,164 @@
+/*
+    iphash.h
+    contains integer hash functors for ipNumber keys
+
+    Hash functors for 32-bit IPv4 addresses, any of which can be the H
+    parameter of the RouteTable hash table in place of ipHash (which
+    forwards to the generic hashfunction::KISS):
+
+    ipMultHash   = multiply-shift: high 32 bits of the 64-bit product
+                   of the address and an odd constant (2^64/phi)
+    ipFmixHash   = MurmurHash3 32-bit finalizer (fmix32)
+    ipCrcHash    = CRC32C of the address, one SSE4.2 crc32 instruction
+                   where available, a bitwise loop otherwise
+
+    All three return the same values whatever the instruction set.
+
+    Each has a batch form, found by HashTable::LookupBatch through
+    HashBatch (hashpolicy.h):
+
+      HashBatch(h, keys, hashes, n)   hashes[i] = h(keys[i]), i < n
+
+    With AVX2, ipMultHash and ipFmixHash hash 8 addresses per step in
+    vector registers. crc32 has no vector form, so ipCrcHash hashes 8
+    independent addresses per step to overlap the instruction latency.
+*/
+
+#ifndef _IPHASH_H
+#define _IPHASH_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__AVX2__) || defined(__SSE4_2__))
+#include <immintrin.h>
+#endif
+
+#include <ipnum.h>
+
+class ipMultHash
+{
+public:
+  uint64_t operator () (const ipNumber& ipn) const
+  {
+    return ((uint64_t)ipn * multiplier) >> 32;
+  }
+  static const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+} ;
+
+class ipFmixHash
+{
+public:
+  uint64_t operator () (const ipNumber& ipn) const
+  {
+    uint32_t h = ipn;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+  }
+} ;
+
+class ipCrcHash
+{
+public:
+  uint64_t operator () (const ipNumber& ipn) const
+  {
+#if defined(__GNUC__) && defined(__SSE4_2__)
+    return _mm_crc32_u32(seed, ipn);
+#else
+    uint32_t crc = seed ^ ipn;
+    for (int i = 0; i < 32; ++i)
+      crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+    return crc;
+#endif
+  }
+  static const uint32_t seed = 0xFFFFFFFFu;
+} ;
+
+#if defined(__GNUC__) && defined(__AVX2__)
+inline void ipStoreHashes (__m256i h, size_t* hashes)
+// widen 8 32-bit hash values to size_t
+{
+  __m256i lo = _mm256_cvtepu32_epi64(_mm256_castsi256_si128(h));
+  __m256i hi = _mm256_cvtepu32_epi64(_mm256_extracti128_si256(h, 1));
+  _mm256_storeu_si256((__m256i*)hashes, lo);
+  _mm256_storeu_si256((__m256i*)(hashes + 4), hi);
+}
+#endif
+
+inline void HashBatch (const ipMultHash& h, const ipNumber* keys, size_t* hashes, size_t n)
+{
+  size_t i = 0;
+#if defined(__GNUC__) && defined(__AVX2__)
+  if (sizeof(size_t) == 8)
+  {
+    // a * x mod 2^64 = x * a_lo + ((x * a_hi) << 32), 4 lanes per product
+    const __m256i aLo = _mm256_set1_epi64x(ipMultHash::multiplier & 0xFFFFFFFFu);
+    const __m256i aHi = _mm256_set1_epi64x(ipMultHash::multiplier >> 32);
+    for ( ; i + 8 <= n; i += 8)
+    {
+      __m128i x0 = _mm_loadu_si128((const __m128i*)(keys + i));
+      __m128i x1 = _mm_loadu_si128((const __m128i*)(keys + i + 4));
+      __m256i w0 = _mm256_cvtepu32_epi64(x0);
+      __m256i w1 = _mm256_cvtepu32_epi64(x1);
+      __m256i p0 = _mm256_add_epi64(_mm256_mul_epu32(w0, aLo),
+                                    _mm256_slli_epi64(_mm256_mul_epu32(w0, aHi), 32));
+      __m256i p1 = _mm256_add_epi64(_mm256_mul_epu32(w1, aLo),
+                                    _mm256_slli_epi64(_mm256_mul_epu32(w1, aHi), 32));
+      _mm256_storeu_si256((__m256i*)(hashes + i), _mm256_srli_epi64(p0, 32));
+      _mm256_storeu_si256((__m256i*)(hashes + i + 4), _mm256_srli_epi64(p1, 32));
+    }
+  }
+#endif
+  for ( ; i < n; ++i)
+    hashes[i] = h(keys[i]);
+}
+
+inline void HashBatch (const ipFmixHash& h, const ipNumber* keys, size_t* hashes, size_t n)
+{
+  size_t i = 0;
+#if defined(__GNUC__) && defined(__AVX2__)
+  if (sizeof(size_t) == 8)
+  {
+    const __m256i c1 = _mm256_set1_epi32((int)0x85EBCA6Bu);
+    const __m256i c2 = _mm256_set1_epi32((int)0xC2B2AE35u);
+    for ( ; i + 8 <= n; i += 8)
+    {
+      __m256i x = _mm256_loadu_si256((const __m256i*)(keys + i));
+      x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+      x = _mm256_mullo_epi32(x, c1);
+      x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 13));
+      x = _mm256_mullo_epi32(x, c2);
+      x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+      ipStoreHashes(x, hashes + i);
+    }
+  }
+#endif
+  for ( ; i < n; ++i)
+    hashes[i] = h(keys[i]);
+}
+
+inline void HashBatch (const ipCrcHash& h, const ipNumber* keys, size_t* hashes, size_t n)
+{
+  size_t i = 0;
+#if defined(__GNUC__) && defined(__SSE4_2__)
+  for ( ; i + 8 <= n; i += 8)
+  {
+    hashes[i]     = _mm_crc32_u32(ipCrcHash::seed, keys[i]);
+    hashes[i + 1] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 1]);
+    hashes[i + 2] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 2]);
+    hashes[i + 3] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 3]);
+    hashes[i + 4] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 4]);
+    hashes[i + 5] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 5]);
+    hashes[i + 6] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 6]);
+    hashes[i + 7] = _mm_crc32_u32(ipCrcHash::seed, keys[i + 7]);
+  }
+#endif
+  for ( ; i < n; ++i)
+    hashes[i] = h(keys[i]);
+}
+
+#endif
@@ -0,0 +1,198 @@
+/*
+    iplog.cpp
+    contains LogWriter and log sink implementations
+*/
+
+#include <cstring>
+#include <iomanip>
+
+#include <iplog.h>
+
+// the two upper case hex digits of each byte value
+class HexTable
+{
+public:
+  char digits_[256][2];
+  HexTable ();
+} ;
+
+HexTable::HexTable ()
+{
+  static const char hex[] = "0123456789ABCDEF";
+  for (unsigned b = 0; b < 256; ++b)
+  {
+    digits_[b][0] = hex[b >> 4];
+    digits_[b][1] = hex[b & 0xF];
+  }
+}
+
+static const HexTable hexTable;
+
+// copies a string literal, without its terminator, and advances p
+#define LOG_LITERAL(p, s) (std::memcpy(p, s, sizeof(s) - 1), p += sizeof(s) - 1)
+
+LogWriter::LogWriter (std::ostream& out, size_t bufferSize)
+  : out_(out), buffer_(bufferSize < 2 * lineMax ? 2 * lineMax : bufferSize),
+    pos_(&buffer_[0]), end_(&buffer_[0] + buffer_.size())
+{}
+
+LogWriter::~LogWriter ()
+{
+  Flush();
+}
+
+void LogWriter::Flush ()
+{
+  if (pos_ > &buffer_[0])
+    out_.write(&buffer_[0], pos_ - &buffer_[0]);
+  pos_ = &buffer_[0];
+}
+
+void LogWriter::Put (const char* s, size_t n)
+{
+  if ((size_t)(end_ - pos_) < n)
+  {
+    Flush();
+    if (n > buffer_.size() / 2) // too long to be worth buffering
+    {
+      out_.write(s, n);
+      return;
+    }
+  }
+  std::memcpy(pos_, s, n);
+  pos_ += n;
+}
+
+inline void LogWriter::Hex (ipNumber n)
+{
+  pos_[0] = hexTable.digits_[n >> 24][0];
+  pos_[1] = hexTable.digits_[n >> 24][1];
+  pos_[2] = hexTable.digits_[(n >> 16) & 0xFF][0];
+  pos_[3] = hexTable.digits_[(n >> 16) & 0xFF][1];
+  pos_[4] = hexTable.digits_[(n >> 8) & 0xFF][0];
+  pos_[5] = hexTable.digits_[(n >> 8) & 0xFF][1];
+  pos_[6] = hexTable.digits_[n & 0xFF][0];
+  pos_[7] = hexTable.digits_[n & 0xFF][1];
+  pos_ += 8;
+}
+
+void LogWriter::Start (const char* msgID, size_t idSize, ipNumber dN)
+// "msgID: <id> dest: <dest>", leaving room for the rest of the line
+{
+  if ((size_t)(end_ - pos_) < lineMax)
+    Flush();
+  LOG_LITERAL(pos_, "msgID: ");
+  for (size_t i = idSize; i < 5; ++i)
+    *pos_++ = ' ';
+  Put(msgID, idSize);
+  if ((size_t)(end_ - pos_) < lineMax)
+    Flush();
+  LOG_LITERAL(pos_, " dest: ");
+  Hex(dN);
+}
+
+void LogWriter::Routed (const char* msgID, size_t idSize, ipNumber dN,
+                        char routeClass, ipNumber netID, ipNumber hostID)
+{
+  Start(msgID, idSize, dN);
+  LOG_LITERAL(pos_, " route class: ");
+  *pos_++ = routeClass;
+  LOG_LITERAL(pos_, " netID: ");
+  Hex(netID);
+  LOG_LITERAL(pos_, " hostID: ");
+  Hex(hostID);
+  *pos_++ = '\n';
+}
+
+void LogWriter::BadClass (const char* msgID, size_t idSize, ipNumber dN)
+{
+  Start(msgID, idSize, dN);
+  LOG_LITERAL(pos_, " NOT ROUTED -- BAD IP CLASS\n");
+}
+
+void LogWriter::NoEntry (const char* msgID, size_t idSize, ipNumber dN)
+{
+  Start(msgID, idSize, dN);
+  LOG_LITERAL(pos_, " NOT ROUTED -- NO TABLE ENTRY\n");
+}
+
+//--------------------------------------------
+//     sinks
+//--------------------------------------------
+
+TextSink::TextSink () : writer_(0)
+{}
+
+TextSink::~TextSink ()
+{
+  Close();
+}
+
+void TextSink::Open (std::ostream& out)
+{
+  Close();
+  writer_ = new LogWriter(out);
+}
+
+void TextSink::Flush ()
+{
+  if (writer_ != 0)
+    writer_->Flush();
+}
+
+void TextSink::Close ()
+// the writer goes with the stream: a later Open may be to a new one
+{
+  delete writer_;  // flushes
+  writer_ = 0;
+}
+
+BinarySink::BinarySink () : out_(0), size_(0)
+{}
+
+BinarySink::~BinarySink ()
+{
+  Close();
+}
+
+void BinarySink::Open (std::ostream& out)
+{
+  Close();
+  out_ = &out;
+}
+
+void BinarySink::Flush ()
+{
+  if (out_ != 0 && size_ > 0)
+    out_->write((const char*)buffer_, size_ * sizeof(Record));
+  size_ = 0;
+}
+
+void BinarySink::Close ()
+{
+  Flush();
+  out_ = 0;
+}
+
+CountSink::CountSink () : checksum_(0)
+{
+  count_[0] = count_[1] = count_[2] = count_[3] = 0;
+}
+
+void CountSink::Merge (const CountSink& s)
+{
+  for (size_t i = 0; i < 4; ++i)
+    count_[i] += s.count_[i];
+  checksum_ += s.checksum_;
+}
+
+void CountSink::Summary (std::ostream& out) const
+{
+  std::ios_base::fmtflags flags = out.flags();
+  char fill = out.fill();
+  out << std::dec << "  routes by class: A " << count_[0] << "  B " << count_[1]
+      << "  C " << count_[2] << "  D " << count_[3] << "  checksum: "
+      << std::hex << std::uppercase << std::setfill('0') << std::setw(16) << checksum_ << '\n';
+  out.flags(flags);
+  out.fill(fill);
+}
@@ -0,0 +1,217 @@
+/*
+    iplog.h
+    contains LogWriter and log sink class definitions
+
+    Defining the LogWriter class for writing the log lines of
+    RouteTable::Go():
+
+      msgID: <id> dest: <dest> route class: <c> netID: <net> hostID: <host>
+      msgID: <id> dest: <dest> NOT ROUTED -- BAD IP CLASS
+      msgID: <id> dest: <dest> NOT ROUTED -- NO TABLE ENTRY
+
+    with <id> right justified in a field of width 5, ipNumbers in 8 digit
+    upper case hex and <c> the letter of the route's ipClass, exactly as
+    the stream inserters would write them.
+
+    Lines are formatted into a buffer allocated once, the hex digits two
+    at a time from a 256 entry table, and the buffer is passed to the
+    stream in one write() whenever it fills, on Flush() and on
+    destruction.
+
+    The sinks are what RouteTable::Go() hands each routed message to.
+    Go() is a template on the sink type, so the calls are resolved at
+    compile time. Each sink has
+
+      Open(out)       start writing to stream out
+      Flush()         pass everything written so far to out
+      Close()         Flush() and stop writing to out
+      Routed(msgID, idSize, dest, route, class letter, netID, hostID)
+      BadClass(msgID, idSize, dest)
+      NoEntry(msgID, idSize, dest)
+      Merge(s)        add the counts of sink s (one sink per thread)
+      Summary(out)    end of Go(): anything to say about the whole run
+
+    TextSink     = the text log, through a LogWriter
+    BinarySink   = one 12 byte record per message, in message order:
+                   dest, route (0 if not routed) as native uint32, then
+                   a status byte (0 routed, 1 bad ip class, 2 no table
+                   entry), the route class letter (0 if not routed) and
+                   2 zero bytes
+    CountSink    = no log; counts routes by class and sums a checksum of
+                   the (dest, route) pairs, independent of message order,
+                   to compare runs; the Summary is one line
+    NullSink     = no log and nothing counted: lookup throughput only
+*/
+
+#ifndef _IPLOG_H
+#define _IPLOG_H
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include <stdint.h>
+
+#include <ipnum.h>
+
+class LogWriter
+{
+public:
+
+  void Routed   (const char* msgID, size_t idSize, ipNumber dN,
+                 char routeClass, ipNumber netID, ipNumber hostID);
+  void BadClass (const char* msgID, size_t idSize, ipNumber dN);
+  void NoEntry  (const char* msgID, size_t idSize, ipNumber dN);
+
+  void Flush    ();
+  // pass the buffered lines to the stream (not flushing the stream itself)
+
+  explicit LogWriter  (std::ostream& out, size_t bufferSize = 1 << 16);
+           ~LogWriter ();
+
+private:
+
+  std::ostream&       out_;
+  std::vector<char>   buffer_;
+  char *              pos_;
+  char *              end_;
+
+  static const size_t lineMax = 96;  // longest line, less the msgID
+
+  void Start (const char* msgID, size_t idSize, ipNumber dN);
+  void Put   (const char* s, size_t n);
+  void Hex   (ipNumber n);  // 8 digits, no room check
+
+  // prevent copying - do not implement
+  LogWriter              (const LogWriter&);
+  LogWriter& operator =  (const LogWriter&);
+} ;
+
+class TextSink
+{
+public:
+  void Open     (std::ostream& out);
+  void Flush    ();
+  void Close    ();
+  void Routed   (const char* msgID, size_t idSize, ipNumber dN, ipNumber,
+                 char routeClass, ipNumber netID, ipNumber hostID)
+  {
+    writer_->Routed(msgID, idSize, dN, routeClass, netID, hostID);
+  }
+  void BadClass (const char* msgID, size_t idSize, ipNumber dN)
+  {
+    writer_->BadClass(msgID, idSize, dN);
+  }
+  void NoEntry  (const char* msgID, size_t idSize, ipNumber dN)
+  {
+    writer_->NoEntry(msgID, idSize, dN);
+  }
+  void Merge    (const TextSink&) {}
+  void Summary  (std::ostream&) const {}
+
+       TextSink  ();
+       ~TextSink ();
+
+private:
+  LogWriter * writer_;
+
+  // prevent copying - do not implement
+  TextSink              (const TextSink&);
+  TextSink& operator =  (const TextSink&);
+} ;
+
+class BinarySink
+{
+public:
+  void Open     (std::ostream& out);
+  void Flush    ();
+  void Close    ();
+  void Routed   (const char*, size_t, ipNumber dN, ipNumber rN,
+                 char routeClass, ipNumber, ipNumber)
+  {
+    Put(dN, rN, 0, routeClass);
+  }
+  void BadClass (const char*, size_t, ipNumber dN)
+  {
+    Put(dN, 0, 1, 0);
+  }
+  void NoEntry  (const char*, size_t, ipNumber dN)
+  {
+    Put(dN, 0, 2, 0);
+  }
+  void Merge    (const BinarySink&) {}
+  void Summary  (std::ostream&) const {}
+
+       BinarySink  ();
+       ~BinarySink ();
+
+private:
+  struct Record
+  {
+    uint32_t dest_;
+    uint32_t route_;
+    uint8_t  status_;
+    uint8_t  class_;
+    uint8_t  reserved_[2];
+  } ;
+
+  static const size_t bufferSize = 4096;  // records
+
+  std::ostream * out_;
+  Record         buffer_[bufferSize];
+  size_t         size_;
+
+  void Put (ipNumber dN, ipNumber rN, uint8_t status, char routeClass)
+  {
+    if (size_ == bufferSize)
+      Flush();
+    Record& r = buffer_[size_++];
+    r.dest_ = dN;
+    r.route_ = rN;
+    r.status_ = status;
+    r.class_ = (uint8_t)routeClass;
+    r.reserved_[0] = r.reserved_[1] = 0;
+  }
+
+  // prevent copying - do not implement
+  BinarySink              (const BinarySink&);
+  BinarySink& operator =  (const BinarySink&);
+} ;
+
+class CountSink
+{
+public:
+  void Open     (std::ostream&) {}
+  void Flush    () {}
+  void Close    () {}
+  void Routed   (const char*, size_t, ipNumber dN, ipNumber rN,
+                 char routeClass, ipNumber, ipNumber)
+  {
+    ++count_[(routeClass - 'A') & 3];
+    checksum_ += (((uint64_t)dN << 32) | rN) * 0x9E3779B97F4A7C15ull;
+  }
+  void BadClass (const char*, size_t, ipNumber) {}
+  void NoEntry  (const char*, size_t, ipNumber) {}
+  void Merge    (const CountSink& s);
+  void Summary  (std::ostream& out) const;
+
+       CountSink ();
+
+private:
+  uint64_t count_[4];  // by route class letter A, B, C, D
+  uint64_t checksum_;
+} ;
+
+class NullSink
+{
+public:
+  void Open     (std::ostream&) {}
+  void Flush    () {}
+  void Close    () {}
+  void Routed   (const char*, size_t, ipNumber, ipNumber, char, ipNumber, ipNumber) {}
+  void BadClass (const char*, size_t, ipNumber) {}
+  void NoEntry  (const char*, size_t, ipNumber) {}
+  void Merge    (const NullSink&) {}
+  void Summary  (std::ostream&) const {}
+} ;
+
+#endif
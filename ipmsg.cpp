@@ -0,0 +1,165 @@
+/*
+    ipmsg.cpp
+    contains MsgReader implementations
+*/
+
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <ipmsg.h>
+
+static inline bool IsSpace (char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool MsgReader::Open (const char* msgfile)
+{
+  Close();
+
+  if (std::strcmp(msgfile, "-") == 0)
+  {
+    in_ = &std::cin;
+    return 1;
+  }
+
+  int fd = open(msgfile, O_RDONLY);
+  if (fd < 0)
+    return 0;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+  {
+    mapSize_ = (size_t)st.st_size;
+    if (mapSize_ == 0) // nothing to map - an empty window
+    {
+      close(fd);
+      return 1;
+    }
+    map_ = mmap(0, mapSize_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map_ != MAP_FAILED)
+    {
+      close(fd);
+      madvise(map_, mapSize_, MADV_SEQUENTIAL);
+      pos_ = (const char*)map_;
+      end_ = pos_ + mapSize_;
+      return 1;
+    }
+    map_ = 0;
+    mapSize_ = 0;
+  }
+  close(fd);
+
+  // not a regular file, or mmap() failed: read it as a stream
+  fin_.clear();
+  fin_.open(msgfile);
+  if (fin_.fail())
+    return 0;
+  in_ = &fin_;
+  return 1;
+} // end MsgReader::Open()
+
+void MsgReader::Attach (const char* begin, const char* end)
+{
+  Close();
+  pos_ = begin;
+  end_ = end;
+}
+
+bool MsgReader::Next (const char*& dS, size_t& dSize, const char*& msgID, size_t& idSize)
+{
+  const char * p = pos_;
+
+  while (p < end_ && IsSpace(*p)) ++p;
+  if (p == end_)
+  {
+    pos_ = p;
+    return 0;
+  }
+  dS = p;
+  while (p < end_ && !IsSpace(*p)) ++p;
+  dSize = p - dS;
+
+  while (p < end_ && IsSpace(*p)) ++p;
+  if (p == end_)
+  {
+    pos_ = p;
+    return 0;
+  }
+  msgID = p;
+  while (p < end_ && !IsSpace(*p)) ++p;
+  idSize = p - msgID;
+
+  pos_ = p;
+  return 1;
+} // end MsgReader::Next()
+
+bool MsgReader::Refill ()
+// reads chunkSize bytes, extended to the end of the line
+{
+  if (in_ == 0 || !in_->good())
+    return 0;
+
+  buffer_.resize(chunkSize);
+  in_->read(&buffer_[0], chunkSize);
+  buffer_.resize(in_->gcount());
+  if (in_->good())
+  {
+    char c;
+    while (in_->get(c))
+    {
+      buffer_ += c;
+      if (c == '\n')
+        break;
+    }
+  }
+  pos_ = buffer_.data();
+  end_ = pos_ + buffer_.size();
+  return !buffer_.empty();
+} // end MsgReader::Refill()
+
+void MsgReader::Close ()
+{
+  if (map_ != 0)
+    munmap(map_, mapSize_);
+  map_ = 0;
+  mapSize_ = 0;
+  if (fin_.is_open())
+    fin_.close();
+  in_ = 0;
+  pos_ = 0;
+  end_ = 0;
+}
+
+bool MsgReader::Mapped () const
+{
+  return in_ == 0;
+}
+
+const char* MsgReader::Pos () const
+{
+  return pos_;
+}
+
+const char* MsgReader::End () const
+{
+  return end_;
+}
+
+void MsgReader::Skip (const char* pos)
+{
+  pos_ = pos;
+}
+
+MsgReader::MsgReader ()
+  :  pos_(0), end_(0), map_(0), mapSize_(0), fin_(), in_(0), buffer_()
+{}
+
+MsgReader::~MsgReader ()
+{
+  Close();
+}
@@ -0,0 +1,76 @@
+/*
+    ipmsg.h
+    contains MsgReader class definition
+
+    Defining the MsgReader class for reading router message files.
+
+    A message file is a sequence of whitespace separated pairs
+      ipString msgID
+    normally one pair per line. MsgReader hands out each token as a
+    pointer and length into a window of file text, so no per-message
+    strings are built.
+
+    A regular file is memory mapped and the window is the whole file.
+    Standard input ("-") and other files that cannot be mapped are read
+    through a stream in chunks of whole lines; when a chunk is used up
+    Next() returns false and Refill() loads the next one. Token pointers
+    stay valid until the next Refill(). In the chunked case a message
+    must not be split across lines.
+
+    A MsgReader can also be attached to a range of text already in
+    memory, which is how Go() hands parts of a file to worker threads.
+*/
+
+#ifndef _IPMSG_H
+#define _IPMSG_H
+
+#include <cstddef>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+class MsgReader
+{
+public:
+
+  bool Open     (const char* msgfile);
+  // "-" reads standard input
+  // return:  false if the file cannot be opened
+
+  void Attach   (const char* begin, const char* end);
+  // read the text in [begin, end), which must outlive the reader
+
+  bool Next     (const char*& dS, size_t& dSize, const char*& msgID, size_t& idSize);
+  // return:  false when the current window has no further message
+
+  bool Refill   ();
+  // return:  false at end of input
+
+  void Close    ();
+  bool Mapped   () const;   // the whole input is one mapped window
+
+  const char* Pos () const; // unread part of the window is [Pos(), End())
+  const char* End () const;
+  void Skip     (const char* pos);
+
+       MsgReader  ();
+       ~MsgReader ();
+
+private:
+
+  const char *   pos_;
+  const char *   end_;
+  void *         map_;      // mapped file, or 0
+  size_t         mapSize_;
+  std::ifstream  fin_;
+  std::istream * in_;       // stream being chunked, or 0
+  std::string    buffer_;   // current chunk of in_
+
+  static const size_t chunkSize = 1 << 20;
+
+  // prevent copying - do not implement
+  MsgReader              (const MsgReader&);
+  MsgReader& operator =  (const MsgReader&);
+} ;
+
+#endif
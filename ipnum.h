@@ -0,0 +1,17 @@
+/*
+    ipnum.h
+    defines ipNumber
+
+    The numeric form of an ip address, shared by iptable.h and the
+    route table's component headers so that each can be included on
+    its own.
+*/
+
+#ifndef _IPNUM_H
+#define _IPNUM_H
+
+#include <stdint.h>
+
+typedef uint32_t      ipNumber;  // 32-bit register
+
+#endif
@@ -0,0 +1,75 @@
+/*
+    iprcu.cpp
+    contains EpochDomain implementations
+*/
+
+#include <thread>
+
+#include <iprcu.h>
+
+EpochDomain::EpochDomain () : epoch_(1), readers_(0)
+{
+  for (size_t i = 0; i < maxReaders; ++i)
+  {
+    slot_[i].epoch_.store(0);
+    slot_[i].used_.store(0);
+  }
+}
+
+size_t EpochDomain::Join ()
+{
+  while (1)
+  {
+    {
+      std::lock_guard<std::mutex> lock(joinMutex_);
+      for (size_t i = 0; i < maxReaders; ++i)
+        if (!slot_[i].used_.load(std::memory_order_relaxed))
+        {
+          slot_[i].used_.store(1, std::memory_order_relaxed);
+          ++readers_;
+          return i;
+        }
+    }
+    std::this_thread::yield();
+  }
+}
+
+void EpochDomain::Leave (size_t slot)
+{
+  std::lock_guard<std::mutex> lock(joinMutex_);
+  slot_[slot].epoch_.store(0, std::memory_order_release);
+  slot_[slot].used_.store(0, std::memory_order_relaxed);
+  --readers_;
+}
+
+uint64_t EpochDomain::Retire ()
+// the caller has already unlinked the object (with a seq_cst exchange);
+// a reader still holding it announced an epoch no later than this one
+{
+  return epoch_.fetch_add(1, std::memory_order_seq_cst);
+}
+
+bool EpochDomain::Safe (uint64_t epoch) const
+{
+  for (size_t i = 0; i < maxReaders; ++i)
+  {
+    uint64_t e = slot_[i].epoch_.load(std::memory_order_seq_cst);
+    if (e != 0 && e <= epoch)
+      return 0;
+  }
+  return 1;
+}
+
+bool EpochDomain::LockIdle ()
+{
+  joinMutex_.lock();
+  if (readers_ == 0)
+    return 1;
+  joinMutex_.unlock();
+  return 0;
+}
+
+void EpochDomain::UnlockIdle ()
+{
+  joinMutex_.unlock();
+}
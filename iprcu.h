@@ -0,0 +1,113 @@
+/*
+    iprcu.h
+    contains EpochDomain and EpochReader class definitions
+
+    Epoch based reclamation for read-copy-update. Readers follow a
+    pointer to an immutable object without taking locks; a writer builds
+    a new object, publishes it by swapping the pointer, and retires the
+    old one, which is freed once no reader can still be using it.
+
+    A reader thread first Join()s the domain, which gives it a slot, and
+    brackets each use of the shared pointer with Enter(slot) ... Exit(slot),
+    loading the pointer with a seq_cst load in between.
+    Enter announces the current global epoch in the slot; Exit clears it.
+    Retire() advances the global epoch and returns the epoch an object
+    unlinked just before the call belongs to; the object may be freed
+    when Safe(epoch), that is when every slot is idle or announces a
+    later epoch. An Enter/Exit section should be short (Go() uses one
+    per block of 64 messages), since it holds back reclamation.
+
+    Each slot is alignas(64), a cache line of its own, so readers
+    announcing their epochs do not share lines; this makes EpochDomain,
+    and a class holding one, line aligned too (on the heap, from C++17).
+
+    LockIdle() lets a writer update in place when no reader has joined:
+    it returns true, holding off Join() until UnlockIdle(), if there are
+    no readers, and false otherwise.
+
+    EpochReader joins and enters for the life of one object, for readers
+    that only need one section.
+*/
+
+#ifndef _IPRCU_H
+#define _IPRCU_H
+
+#include <cstddef>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+class EpochDomain
+{
+public:
+
+  size_t   Join       ();
+  void     Leave      (size_t slot);
+  // claim and give back a reader slot; Join waits while all are taken
+
+  void     Enter      (size_t slot);
+  void     Exit       (size_t slot);
+
+  uint64_t Retire     ();
+  bool     Safe       (uint64_t epoch) const;
+
+  bool     LockIdle   ();
+  void     UnlockIdle ();
+
+           EpochDomain ();
+
+  static const size_t maxReaders = 64;
+
+private:
+
+  struct alignas(64) Slot
+  {
+    std::atomic<uint64_t>  epoch_;   // 0 = not in a section
+    std::atomic<bool>      used_;
+  } ;
+
+  Slot                   slot_[maxReaders];
+  std::atomic<uint64_t>  epoch_;
+  std::mutex             joinMutex_;
+  size_t                 readers_;   // slots in use, guarded by joinMutex_
+
+  // prevent copying - do not implement
+  EpochDomain              (const EpochDomain&);
+  EpochDomain& operator =  (const EpochDomain&);
+} ;
+
+inline void EpochDomain::Enter (size_t slot)
+{
+  // seq_cst, as are the reader's load of the shared pointer and the
+  // writer's exchange of it: either the writer sees this announcement
+  // or the reader sees the new pointer
+  slot_[slot].epoch_.store(epoch_.load(std::memory_order_acquire), std::memory_order_seq_cst);
+}
+
+inline void EpochDomain::Exit (size_t slot)
+{
+  slot_[slot].epoch_.store(0, std::memory_order_release);
+}
+
+class EpochReader
+{
+public:
+  explicit EpochReader (EpochDomain& domain) : domain_(domain), slot_(domain.Join())
+  {
+    domain_.Enter(slot_);
+  }
+  ~EpochReader ()
+  {
+    domain_.Exit(slot_);
+    domain_.Leave(slot_);
+  }
+private:
+  EpochDomain& domain_;
+  size_t       slot_;
+
+  // prevent copying - do not implement
+  EpochReader              (const EpochReader&);
+  EpochReader& operator =  (const EpochReader&);
+} ;
+
+#endif
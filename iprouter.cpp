@@ -3,12 +3,18 @@
     03/26/2012
 
     simulating an Internet router
+
+    usage: iprouter [-dir] [batchfile]
+      -dir        use the DIR-24-8 lookup engine (see ipdir.h)
+      batchfile   read commands from batchfile instead of keyboard
 */
 
 #include <fstream>
 #include <iomanip>
 #include <cstdlib>
 #include <cctype>
+#include <cstring>
+#include <thread>
 
 #include <xstring.h>
 #include <iptable.h>
@@ -18,6 +24,13 @@
 #include <bitvect.cpp>
 #include <hash.cpp>
 #include <primes.cpp>
+#include <iptrie.cpp>
+#include <ipdir.cpp>
+#include <ipmsg.cpp>
+#include <ipstats.cpp>
+#include <iplog.cpp>
+#include <ipcache.cpp>
+#include <iprcu.cpp>
 #include <iptable.cpp>
 // */
 
@@ -31,10 +44,16 @@ int main(int argc, char* argv[])
   std::ifstream ifs;
   std::istream * inptr = &std::cin;
   bool BATCH = 0;
-  if (argc > 1)
+  RouteEngine engine = trieEngine;
+  for (int arg = 1; arg < argc; ++arg)
   {
+    if (std::strcmp(argv[arg], "-dir") == 0)
+    {
+      engine = dirEngine;
+      continue;
+    }
     BATCH = 1;
-    ifs.open(argv[1]);
+    ifs.open(argv[arg]);
     if (ifs.fail()) return 0;
     inptr = &ifs;
   }
@@ -47,9 +66,10 @@ int main(int argc, char* argv[])
   if (numBuckets == 0)
     return 0;
 
-  RouteTable routeTable (numBuckets);
-  char file1 [maxFilenameSize], file2 [maxFilenameSize];
+  RouteTable routeTable (numBuckets, engine);
+  char file1 [maxFilenameSize], file2 [maxFilenameSize], file3 [maxFilenameSize];
   char selection;
+  unsigned int numThreads, cacheSets;
 
   ipString dS,   // destination (dot notation)
            rS;   // route       (dot notation)
@@ -102,22 +122,36 @@ int main(int argc, char* argv[])
         routeTable.Save(file1);
         break;
 
+      case 'B': case 'b':
+        std::cout << "  Enter snapshot file name: ";
+        *inptr >> std::setw(maxFilenameSize) >> file1;
+	if (BATCH) std::cout << file1 << '\n';
+        routeTable.LoadBinary(file1);
+        break;
+
+      case 'W': case 'w':
+        std::cout << "  Enter snapshot file name: ";
+        *inptr >> std::setw(maxFilenameSize) >> file1;
+	if (BATCH) std::cout << file1 << '\n';
+        routeTable.SaveBinary(file1);
+        break;
+
       case 'I': case 'i':
-        std::cout << "  Enter destination and route (dot notation): ";
+        std::cout << "  Enter destination[/len] and route (dot notation): ";
         *inptr >> dS >> rS;
 	if (BATCH) std::cout << dS << ' ' << rS << '\n';
         routeTable.Insert(dS, rS);
         break;
 
       case 'R': case 'r':
-        std::cout << "  Enter destination (dot notation): ";
+        std::cout << "  Enter destination[/len] (dot notation): ";
         *inptr >> dS;
 	if (BATCH) std::cout << dS << '\n';
         routeTable.Remove(dS);
         break;
 
       case 'G': case 'g':
-        std::cout << "                  Enter msg file name: ";
+        std::cout << "    Enter msg file name (- for stdin): ";
         *inptr >> std::setw(maxFilenameSize) >> file1;
 	if (BATCH) std::cout << file1 << '\n';
         std::cout << "  Enter log file name (0 for default): ";
@@ -129,10 +163,66 @@ int main(int argc, char* argv[])
           routeTable.Go(file1, file2);
         break;
 
+      case 'P': case 'p':
+        std::cout << "  Enter stats file name: ";
+        *inptr >> std::setw(maxFilenameSize) >> file1;
+	if (BATCH) std::cout << file1 << '\n';
+        routeTable.Stats(file1);
+        break;
+
+      case 'O': case 'o':
+        std::cout << "  Enter log format (text, binary, count, null): ";
+        *inptr >> std::setw(maxFilenameSize) >> file1;
+	if (BATCH) std::cout << file1 << '\n';
+        if (std::strcmp(file1, "text") == 0)
+          routeTable.SetLogFormat(textLog);
+        else if (std::strcmp(file1, "binary") == 0)
+          routeTable.SetLogFormat(binaryLog);
+        else if (std::strcmp(file1, "count") == 0)
+          routeTable.SetLogFormat(countLog);
+        else if (std::strcmp(file1, "null") == 0)
+          routeTable.SetLogFormat(nullLog);
+        else
+          std::cout << "  ** unknown log format " << file1 << '\n';
+        break;
+
+      case 'K': case 'k':
+        std::cout << "  Enter number of route cache sets (0 for none): ";
+        *inptr >> cacheSets;
+	if (BATCH) std::cout << cacheSets << '\n';
+        routeTable.SetCache(cacheSets);
+        break;
+
+      case 'U': case 'u':
+        std::cout << "    Enter msg file name (- for stdin): ";
+        *inptr >> std::setw(maxFilenameSize) >> file1;
+	if (BATCH) std::cout << file1 << '\n';
+        std::cout << "  Enter log file name (0 for default): ";
+        *inptr >> std::setw(maxFilenameSize) >> file2;
+	if (BATCH) std::cout << file2 << '\n';
+        std::cout << "  Enter table file name to load meanwhile: ";
+        *inptr >> std::setw(maxFilenameSize) >> file3;
+	if (BATCH) std::cout << file3 << '\n';
+        {
+          // Load() is applied while Go() is routing (see iptable.h)
+          std::thread go(&RouteTable::Go, &routeTable, file1,
+                         file2[0] == '0' ? (const char*)0 : file2);
+          routeTable.Load(file3);
+          go.join();
+        }
+        break;
+
       case 'C': case 'c':
         routeTable.Clear();
         break;
 
+      case 'T': case 't':
+        std::cout << "  Enter number of Go() threads: ";
+        *inptr >> numThreads;
+	if (BATCH) std::cout << numThreads << '\n';
+        routeTable.SetThreads(numThreads);
+        break;
+
       case 'D': case 'd':
         std::cout << "  Enter Dump file name (0 for default): ";
         *inptr >> std::setw(maxFilenameSize) >> file1;
@@ -143,9 +233,9 @@ int main(int argc, char* argv[])
           routeTable.Dump(file1);
         break;
 
-	// case 'A': case 'a':
-	// routeTable.Analysis();
-	// break;
+      case 'A': case 'a':
+        routeTable.Analysis();
+        break;
 
       case 'M': case 'm':
         DisplayMenu();
@@ -167,11 +257,18 @@ void DisplayMenu()
              << "------     -----------              -------\n"
              << "Load       (filename)  ................  L\n"
              << "Save       (filename)  ................  S\n"
-             << "Insert     (ipS, ipS)  ................  I\n"
-             << "Remove     (ipS)  .....................  R\n"
+             << "LoadBinary (filename)  ................  B\n"
+             << "SaveBinary (filename)  ................  W\n"
+             << "Insert     (ipS[/n], ipS)  ............  I\n"
+             << "Remove     (ipS[/n])  .................  R\n"
              << "Go         (filename, filename)  ......  G\n"
+             << "Go + Load  (filename, filename, filename)  U\n"
+             << "Stats      (filename)  ................  P\n"
+             << "LogFormat  (text|binary|count|null)  ..  O\n"
              << "Clear      ()  ........................  C\n"
-     // << "Analysis   ()  ........................  A\n"
+             << "Threads    (n)  .......................  T\n"
+             << "Cache      (sets)  ....................  K\n"
+             << "Analysis   ()  ........................  A\n"
              << "Dump       ()  ........................  D\n"
              << "Display menu  .........................  M\n"
              << "Switch to interactive mode  ...........  X\n"
@@ -0,0 +1,203 @@
+/*
+    ipstats.cpp
+    contains LatencyHistogram and RouteStats implementations
+*/
+
+#include <fstream>
+#include <iomanip>
+
+#include <ipstats.h>
+
+//--------------------------------------------
+//     LatencyHistogram
+//--------------------------------------------
+
+LatencyHistogram::LatencyHistogram ()
+{
+  Clear();
+}
+
+void LatencyHistogram::Clear ()
+{
+  for (unsigned i = 0; i < numBuckets; ++i)
+    count_[i] = 0;
+  total_ = sum_ = max_ = 0;
+}
+
+unsigned LatencyHistogram::Index (uint64_t value)
+{
+  if (value < subBuckets)
+    return (unsigned)value;
+  unsigned e;  // index of the highest set bit, >= subBits
+#if defined(__GNUC__)
+  e = 63 - __builtin_clzll(value);
+#else
+  for (e = 63; (value >> e) == 0; --e);
+#endif
+  return subBuckets + (e - subBits) * subBuckets
+         + (unsigned)((value >> (e - subBits)) & (subBuckets - 1));
+}
+
+uint64_t LatencyHistogram::Value (unsigned index)
+{
+  if (index < subBuckets)
+    return index;
+  unsigned e = (index - subBuckets) / subBuckets + subBits;
+  uint64_t sub = (index - subBuckets) % subBuckets;
+  return ((subBuckets + sub + 1) << (e - subBits)) - 1;
+}
+
+void LatencyHistogram::Record (uint64_t value, uint64_t count)
+{
+  count_[Index(value)] += count;
+  total_ += count;
+  sum_ += value * count;
+  if (value > max_)
+    max_ = value;
+}
+
+void LatencyHistogram::Merge (const LatencyHistogram& h)
+{
+  for (unsigned i = 0; i < numBuckets; ++i)
+    count_[i] += h.count_[i];
+  total_ += h.total_;
+  sum_ += h.sum_;
+  if (h.max_ > max_)
+    max_ = h.max_;
+}
+
+uint64_t LatencyHistogram::Count () const
+{
+  return total_;
+}
+
+uint64_t LatencyHistogram::Max () const
+{
+  return max_;
+}
+
+double LatencyHistogram::Mean () const
+{
+  return total_ ? (double)sum_ / total_ : 0.0;
+}
+
+uint64_t LatencyHistogram::Percentile (double p) const
+{
+  if (total_ == 0)
+    return 0;
+  uint64_t rank = (uint64_t)(p / 100.0 * total_ + 0.5), seen = 0;
+  if (rank == 0) rank = 1;
+  for (unsigned i = 0; i < numBuckets; ++i)
+  {
+    seen += count_[i];
+    if (seen >= rank)
+      return Value(i) < max_ ? Value(i) : max_;
+  }
+  return max_;
+}
+
+//--------------------------------------------
+//     RouteStats
+//--------------------------------------------
+
+RouteStats::RouteStats ()
+{
+  Clear();
+}
+
+void RouteStats::Clear ()
+{
+  routed_ = badClass_ = noEntry_ = blocks_ = 0;
+  cacheHits_ = cacheMisses_ = 0;
+  seconds_ = 0;
+  for (unsigned s = 0; s < numStages; ++s)
+    stage_[s].Clear();
+}
+
+void RouteStats::Merge (const RouteStats& s)
+{
+  routed_ += s.routed_;
+  badClass_ += s.badClass_;
+  noEntry_ += s.noEntry_;
+  blocks_ += s.blocks_;
+  cacheHits_ += s.cacheHits_;
+  cacheMisses_ += s.cacheMisses_;
+  for (unsigned t = 0; t < numStages; ++t)
+    stage_[t].Merge(s.stage_[t]);
+}
+
+uint64_t RouteStats::Messages () const
+{
+  return routed_ + badClass_ + noEntry_;
+}
+
+const char* RouteStats::StageName (unsigned stage)
+{
+  static const char* name[numStages] = { "parse", "lookup", "format" };
+  return name[stage];
+}
+
+void RouteStats::Report (std::ostream& os) const
+{
+  std::ios_base::fmtflags flags = os.flags();
+  std::streamsize precision = os.precision();
+  uint64_t n = Messages();
+  os << std::dec << std::fixed << std::setprecision(3)
+     << "  messages:        " << n << '\n'
+     << "    routed:        " << routed_ << '\n'
+     << "    bad ip class:  " << badClass_ << '\n'
+     << "    no entry:      " << noEntry_ << '\n'
+     << "  time:            " << seconds_ << " s";
+  if (seconds_ > 0)
+    os << std::setprecision(0) << "  (" << n / seconds_ << " messages/s)";
+  os << '\n';
+  if (cacheHits_ + cacheMisses_ > 0)
+    os << std::setprecision(1)
+       << "  route cache:     " << cacheHits_ << " hits, " << cacheMisses_ << " misses ("
+       << 100.0 * cacheHits_ / (cacheHits_ + cacheMisses_) << "% hits)\n";
+  os << std::setprecision(1)
+     << "  ns per message    sampled      mean       p50       p90       p99       max\n";
+  for (unsigned s = 0; s < numStages; ++s)
+  {
+    const LatencyHistogram& h = stage_[s];
+    os << "    " << std::left << std::setw(10) << StageName(s) << std::right
+       << std::setw(11) << h.Count() << std::setw(10) << h.Mean()
+       << std::setw(10) << h.Percentile(50) << std::setw(10) << h.Percentile(90)
+       << std::setw(10) << h.Percentile(99) << std::setw(10) << h.Max() << '\n';
+  }
+  os.flags(flags);
+  os.precision(precision);
+}
+
+bool RouteStats::Write (const char* statsfile) const
+{
+  std::ofstream out;
+  out.open(statsfile);
+  if (out.fail())
+    return 0;
+  out << std::fixed << std::setprecision(6)
+      << "messages " << Messages() << '\n'
+      << "routed " << routed_ << '\n'
+      << "bad_class " << badClass_ << '\n'
+      << "no_entry " << noEntry_ << '\n'
+      << "blocks " << blocks_ << '\n'
+      << "sample_interval " << sampleInterval << '\n'
+      << "seconds " << seconds_ << '\n'
+      << "messages_per_second " << (seconds_ > 0 ? Messages() / seconds_ : 0.0) << '\n'
+      << "cache_hits " << cacheHits_ << '\n'
+      << "cache_misses " << cacheMisses_ << '\n';
+  for (unsigned s = 0; s < numStages; ++s)
+  {
+    const LatencyHistogram& h = stage_[s];
+    const char* name = StageName(s);
+    out << name << "_samples " << h.Count() << '\n'
+        << name << "_mean_ns " << h.Mean() << '\n'
+        << name << "_p50_ns " << h.Percentile(50) << '\n'
+        << name << "_p90_ns " << h.Percentile(90) << '\n'
+        << name << "_p99_ns " << h.Percentile(99) << '\n'
+        << name << "_p999_ns " << h.Percentile(99.9) << '\n'
+        << name << "_max_ns " << h.Max() << '\n';
+  }
+  out.close();
+  return 1;
+}
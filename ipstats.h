@@ -0,0 +1,96 @@
+/*
+    ipstats.h
+    contains LatencyHistogram and RouteStats class definitions
+
+    RouteStats collects what RouteTable::Go() measures: the number of
+    messages routed, dropped for a bad ip class and dropped for lack of a
+    table entry, the wall time of the run, and for each stage of routing
+    (parse, lookup, format) a histogram of the time per message.
+
+    Go() routes messages in blocks (see RouteTable::Route). One block in
+    sampleInterval is timed, stage by stage, with std::chrono::steady_clock,
+    and each stage time divided by the block size is recorded once per
+    message of the block. The other blocks are only counted, so the clock
+    is read 4 times per sampleInterval * 64 messages.
+
+    LatencyHistogram is log-linear in the manner of HdrHistogram: values
+    below 2^subBits are counted exactly, and each power of two above is
+    split into 2^subBits sub-buckets, so a reported value is within
+    1/2^subBits (12.5%) of the true one. It is a fixed array and records
+    without allocating.
+
+    Report() prints a summary for people, Write() the same figures as
+    "name value" lines for programs.
+*/
+
+#ifndef _IPSTATS_H
+#define _IPSTATS_H
+
+#include <cstddef>
+#include <iostream>
+#include <stdint.h>
+
+class LatencyHistogram
+{
+public:
+
+  void     Record     (uint64_t value, uint64_t count = 1);
+  void     Merge      (const LatencyHistogram& h);
+  void     Clear      ();
+
+  uint64_t Count      () const;
+  uint64_t Max        () const;
+  double   Mean       () const;
+  uint64_t Percentile (double p) const;
+  // smallest recorded value v (to histogram precision) such that
+  // p percent of the recorded values are <= v; 0 when empty
+
+           LatencyHistogram ();
+
+private:
+
+  static const unsigned subBits    = 3;
+  static const unsigned subBuckets = 1 << subBits;
+  static const unsigned numBuckets = subBuckets + (64 - subBits) * subBuckets;
+
+  static unsigned Index (uint64_t value);
+  static uint64_t Value (unsigned index);  // highest value of bucket index
+
+  uint64_t count_ [numBuckets];
+  uint64_t total_;
+  uint64_t sum_;
+  uint64_t max_;
+} ;
+
+enum RouteStage { parseStage, lookupStage, formatStage, numStages };
+
+class RouteStats
+{
+public:
+
+  void  Clear   ();
+  void  Merge   (const RouteStats& s);
+
+  void  Report  (std::ostream& os) const;
+  bool  Write   (const char* statsfile) const;
+  // return:  false if the file cannot be opened
+
+  uint64_t Messages () const;
+
+  uint64_t          routed_;
+  uint64_t          badClass_;
+  uint64_t          noEntry_;
+  uint64_t          blocks_;     // blocks routed, sampled or not
+  uint64_t          cacheHits_;  // RouteCache, when Go() has one
+  uint64_t          cacheMisses_;
+  double            seconds_;    // wall time of the whole Go()
+  LatencyHistogram  stage_ [numStages];  // ns per message, sampled
+
+  static const uint64_t sampleInterval = 16;  // blocks per timed block
+
+  static const char* StageName (unsigned stage);
+
+           RouteStats ();
+} ;
+
+#endif
@@ -6,14 +6,47 @@
 */
 
 #include <fstream>
+#include <sstream>
 #include <iomanip>
 #include <cstring>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <iptable.h>
 
+#if defined(__SSSE3__) && defined(__GNUC__)
+#include <tmmintrin.h>
+#endif
+
+// timing for the Go() statistics
+typedef std::chrono::steady_clock Clock;
+
+// writes "prefix/len route" lines for Save() and Dump()
+class PrefixWriter
+{
+public:
+  PrefixWriter (std::ostream& os, char sep) : os_(os), sep_(sep) {}
+  void operator () (ipNumber prefix, uint32_t len, ipNumber route)
+  {
+    os_ << std::setw(8) << prefix << '/' << std::dec << len << std::hex
+        << sep_ << std::setw(8) << route << '\n';
+  }
+private:
+  std::ostream& os_;
+  char          sep_;
+} ;
+
 void RouteTable::Load (const char* loadfile)
 {
   std::ifstream fin;
-  ipNumber dN, rN;
+  ipNumber dN, rN, netID, hostID;
+  uint32_t len;
+  std::vector < EntryType > hosts; // /32 entries, loaded in bulk at the end
 
   fin.open(loadfile);
 
@@ -24,17 +57,38 @@ void RouteTable::Load (const char* loadfile)
     return;
   }
 
+  RouteVersion* v = BeginUpdate();
   fin >> std::hex;
-  fin >> dN >> rN;
+  fin >> dN;
 
   while (!fin.fail())
   {
-    if (dN != 0 && rN != 0)
-      tablePtr_->Insert(dN, rN);
-    fin >> dN >> rN;
+    // optional "/len" suffix (decimal) marks a prefix entry
+    len = 32;
+    if (fin.peek() == '/')
+    {
+      fin.get();
+      fin >> std::dec >> len >> std::hex;
+    }
+    fin >> rN;
+    if (fin.fail())
+      break;
+
+    // route must be valid, as in Insert()
+    if (ipInterpret(rN, netID, hostID) != badClass && len <= 32
+        && (dN != 0 || len == 0) && RouteTrie::Mask(dN, len) == dN)
+    {
+      if (len == 32)
+        hosts.push_back(EntryType(dN, rN));
+      else
+        Add(*v, dN, len, rN);
+    }
+    fin >> dN;
   }
 
   fin.close();
+  AddHosts(*v, hosts);
+  EndUpdate(v);
   std::cout << "  Load() completed\n";
 } // end RouteTable::Load()
 
@@ -52,28 +106,214 @@ void RouteTable::Save (const char* savefile)
     return;
   }
 
+  EpochReader reader(epochs_);
+  const RouteVersion& v = *current_.load(std::memory_order_seq_cst);
   fout << std::hex << std::uppercase << std::setfill('0');
-  i = tablePtr_->Begin();
+  i = v.tablePtr_->Begin();
 
-  while (i != tablePtr_->End())
+  while (i != v.tablePtr_->End())
   {
     fout << std::setw(8) << (*i).key_ << ' ' << std::setw(8) << (*i).data_ << '\n';
     ++i;
   }
 
+  PrefixWriter pw(fout, ' ');
+  v.triePtr_->Traverse(pw);
+
   fout.close();
   std::cout << "  Save() completed\n";
 } // end RouteTable::Save()
 
+// binary snapshot layout, see iptable.h
+struct SnapshotHeader
+{
+  char      magic_[4];
+  uint32_t  version_;
+  uint32_t  byteOrder_;
+  uint32_t  reserved_;
+  uint64_t  hostCount_;
+  uint64_t  prefixCount_;
+  uint64_t  checksum_;
+} ;
+
+static const char     snapshotMagic[4] = { 'I', 'P', 'R', 'T' };
+static const uint32_t snapshotVersion  = 1;
+static const uint32_t snapshotOrder    = 0x01020304;
+
+// FNV-1a over 32-bit words
+static uint64_t SnapshotChecksum (const uint32_t* word, size_t n, uint64_t h = 0xCBF29CE484222325ull)
+{
+  for (size_t i = 0; i < n; ++i)
+    h = (h ^ word[i]) * 0x100000001B3ull;
+  return h;
+}
+
+// true if payload bytes hold exactly the header's counts of host (2 word)
+// and prefix (3 word) records; the counts come from the file, so they are
+// bounded by division before anything is multiplied
+static bool SnapshotFits (const SnapshotHeader& header, uint64_t payload)
+{
+  const uint64_t hostSize = 2 * sizeof(uint32_t), prefixSize = 3 * sizeof(uint32_t);
+  if (header.hostCount_ > payload / hostSize)
+    return 0;
+  payload -= header.hostCount_ * hostSize;
+  if (header.prefixCount_ > payload / prefixSize)
+    return 0;
+  return payload == header.prefixCount_ * prefixSize;
+}
+
+// collects trie prefixes as (prefix, route, len) words for SaveBinary()
+class PrefixCollector
+{
+public:
+  PrefixCollector (std::vector<uint32_t>& words) : words_(words) {}
+  void operator () (ipNumber prefix, uint32_t len, ipNumber route)
+  {
+    words_.push_back(prefix);
+    words_.push_back(route);
+    words_.push_back(len);
+  }
+private:
+  std::vector<uint32_t>& words_;
+} ;
+
+void RouteTable::SaveBinary (const char* savefile)
+{
+  std::ofstream fout;
+  TableType::Iterator i;
+  std::vector<uint32_t> hosts, prefixes;
+  SnapshotHeader header;
+
+  fout.open(savefile, std::ios::out | std::ios::binary);
+  if (fout.fail())
+  {
+    std::cerr << "** RouteTable: unable to open file " << savefile << '\n'
+              << "   SaveBinary() aborted\n";
+    return;
+  }
+
+  {
+    EpochReader reader(epochs_);
+    const RouteVersion& v = *current_.load(std::memory_order_seq_cst);
+    hosts.reserve(2 * v.tablePtr_->Size());
+    for (i = v.tablePtr_->Begin(); i != v.tablePtr_->End(); ++i)
+    {
+      hosts.push_back((*i).key_);
+      hosts.push_back((*i).data_);
+    }
+    prefixes.reserve(3 * v.triePtr_->Size());
+    PrefixCollector pc(prefixes);
+    v.triePtr_->Traverse(pc);
+  }
+
+  std::memcpy(header.magic_, snapshotMagic, 4);
+  header.version_     = snapshotVersion;
+  header.byteOrder_   = snapshotOrder;
+  header.reserved_    = 0;
+  header.hostCount_   = hosts.size() / 2;
+  header.prefixCount_ = prefixes.size() / 3;
+  header.checksum_    = SnapshotChecksum(hosts.data(), hosts.size());
+  header.checksum_    = SnapshotChecksum(prefixes.data(), prefixes.size(), header.checksum_);
+
+  fout.write((const char*)&header, sizeof(header));
+  fout.write((const char*)hosts.data(), hosts.size() * sizeof(uint32_t));
+  fout.write((const char*)prefixes.data(), prefixes.size() * sizeof(uint32_t));
+  if (fout.fail())
+  {
+    std::cerr << "** RouteTable: write to file " << savefile << " failed\n"
+              << "   SaveBinary() aborted\n";
+    return;
+  }
+  fout.close();
+  std::cout << "  SaveBinary() completed\n";
+} // end RouteTable::SaveBinary()
+
+void RouteTable::LoadBinary (const char* loadfile)
+{
+  int fd = open(loadfile, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0)
+  {
+    if (fd >= 0) close(fd);
+    std::cerr << "** RouteTable: unable to open file " << loadfile << '\n'
+              << "   LoadBinary() aborted\n";
+    return;
+  }
+
+  size_t fileSize = (size_t)st.st_size;
+  void * map = (fileSize >= sizeof(SnapshotHeader))
+             ? mmap(0, fileSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    std::cerr << "** RouteTable: unable to map file " << loadfile << '\n'
+              << "   LoadBinary() aborted\n";
+    return;
+  }
+  madvise(map, fileSize, MADV_SEQUENTIAL);
+
+  const SnapshotHeader * header = (const SnapshotHeader*) map;
+  const uint32_t * hosts = (const uint32_t*) (header + 1);
+  const uint32_t * prefixes = 0;
+  const char * problem = 0;
+
+  if (std::memcmp(header->magic_, snapshotMagic, 4) != 0)
+    problem = "not a route table snapshot";
+  else if (header->version_ != snapshotVersion || header->byteOrder_ != snapshotOrder)
+    problem = "unsupported snapshot version or byte order";
+  else if (!SnapshotFits(*header, fileSize - sizeof(SnapshotHeader)))
+    problem = "snapshot size does not match its header";
+  else
+  {
+    prefixes = hosts + 2 * header->hostCount_;
+    uint64_t checksum = SnapshotChecksum(hosts, 2 * header->hostCount_);
+    checksum = SnapshotChecksum(prefixes, 3 * header->prefixCount_, checksum);
+    if (checksum != header->checksum_)
+      problem = "snapshot checksum mismatch";
+  }
+
+  if (problem != 0)
+  {
+    munmap(map, fileSize);
+    std::cerr << "** RouteTable: " << problem << " in " << loadfile << '\n'
+              << "   LoadBinary() aborted\n";
+    return;
+  }
+
+  ipNumber netID, hostID;
+  std::vector < EntryType > entries;
+  entries.reserve(header->hostCount_);
+  for (uint64_t i = 0; i < header->hostCount_; ++i, hosts += 2)
+    if (hosts[0] != 0 && ipInterpret(hosts[1], netID, hostID) != badClass)
+      entries.push_back(EntryType(hosts[0], hosts[1]));
+  RouteVersion* v = BeginUpdate();
+  AddHosts(*v, entries);
+  for (uint64_t i = 0; i < header->prefixCount_; ++i, prefixes += 3)
+    if (prefixes[2] < 32 && RouteTrie::Mask(prefixes[0], prefixes[2]) == prefixes[0]
+        && ipInterpret(prefixes[1], netID, hostID) != badClass)
+      Add(*v, prefixes[0], prefixes[2], prefixes[1]);
+  EndUpdate(v);
+
+  munmap(map, fileSize);
+  std::cout << "  LoadBinary() completed\n";
+} // end RouteTable::LoadBinary()
+
 void RouteTable::Insert(const ipString& dS, const ipString& rS)
 {
   ipNumber dN, rN, netID, hostID;
+  uint32_t len;
   ipClass ipC;
 
-  dN = ipS2ipN(dS);
+  if (!ipS2Prefix(dS, dN, len))
+  {
+    std::cerr << "** RouteTable: bad destination prefix\n"
+              << "   Insert() aborted\n";
+    return;
+  }
+
   ipC = ipInterpret (dN, netID, hostID);
 
-  if (ipC == badClass)
+  if (ipC == badClass && len != 0) // 0.0.0.0/0 is the default route
   {
     std::cerr << "** RouteTable: bad destination number\n"
               << "   Insert() aborted\n";
@@ -90,16 +330,164 @@ void RouteTable::Insert(const ipString& dS, const ipString& rS)
     return;
   }
 
-  tablePtr_->Insert(dN, rN);
+  RouteVersion* v = BeginUpdate();
+  Add(*v, dN, len, rN);
+  EndUpdate(v);
 } // end RouteTable::Insert()
 
 void RouteTable::Remove (const ipString& dS)
 {
-  ipNumber dN = ipS2ipN(dS);
+  ipNumber dN;
+  uint32_t len;
+
+  if (!ipS2Prefix(dS, dN, len))
+    return;
 
-  tablePtr_->Remove(dN);
+  RouteVersion* v = BeginUpdate();
+  Drop(*v, dN, len);
+  EndUpdate(v);
 } // end RouteTable::Remove()
 
+bool RouteTable::Lookup (const ipNumber& dN, ipNumber& rN) const
+// an exact /32 entry is the longest possible match, so try it first
+{
+  EpochReader reader(epochs_);
+  const RouteVersion& v = *current_.load(std::memory_order_seq_cst);
+  if (v.dirPtr_ != 0)
+    return v.dirPtr_->Lookup(dN, rN);
+  if (v.tablePtr_->Retrieve(dN, rN))
+    return 1;
+  return v.triePtr_->Lookup(dN, rN);
+} // end RouteTable::Lookup()
+
+void RouteTable::LookupBatch (const ipNumber* dN, ipNumber* rN, uint8_t* found, size_t n) const
+// Lookup() for n destinations; found[i] tells whether rN[i] was set
+{
+  EpochReader reader(epochs_);
+  LookupBatch(*current_.load(std::memory_order_seq_cst), dN, rN, found, n);
+} // end RouteTable::LookupBatch()
+
+void RouteTable::LookupBatch (const RouteVersion& v, const ipNumber* dN, ipNumber* rN,
+                              uint8_t* found, size_t n)
+{
+  if (v.dirPtr_ != 0)
+  {
+    v.dirPtr_->LookupBatch(dN, rN, found, n);
+    return;
+  }
+  v.tablePtr_->LookupBatch(dN, rN, found, n);
+  if (v.triePtr_->Empty())
+    return;
+  for (size_t i = 0; i < n; ++i)
+    if (!found[i])
+      found[i] = v.triePtr_->Lookup(dN[i], rN[i]);
+} // end RouteTable::LookupBatch()
+
+void RouteTable::Add (RouteVersion& v, ipNumber dN, uint32_t len, ipNumber rN)
+{
+  if (len == 32)
+    v.tablePtr_->Insert(dN, rN);
+  else
+    v.triePtr_->Insert(dN, len, rN);
+  if (v.dirPtr_ != 0)
+    v.dirPtr_->Insert(dN, len, rN);
+} // end RouteTable::Add()
+
+void RouteTable::AddHosts (RouteVersion& v, const std::vector < EntryType >& hosts)
+// Add() for a batch of /32 entries: the hash table is presized once and
+// filled by BulkLoad; later duplicates win, as with repeated Add()
+{
+  if (hosts.empty())
+    return;
+  v.tablePtr_->BulkLoad(hosts.begin(), hosts.end(), fsu::keepLast);
+  if (v.dirPtr_ != 0)
+    for (size_t i = 0; i < hosts.size(); ++i)
+      v.dirPtr_->Insert(hosts[i].key_, 32, hosts[i].data_);
+} // end RouteTable::AddHosts()
+
+void RouteTable::Drop (RouteVersion& v, ipNumber dN, uint32_t len)
+{
+  bool removed;
+  if (len == 32)
+    removed = v.tablePtr_->Remove(dN);
+  else
+    removed = v.triePtr_->Remove(dN, len);
+
+  if (removed && v.dirPtr_ != 0)
+  {
+    // fall back to the longest remaining prefix covering dN/len
+    ipNumber replRoute = 0;
+    uint32_t replLen = 0;
+    if (len == 0 || !v.triePtr_->Lookup(dN, len - 1, replRoute, replLen))
+    {
+      replRoute = 0;
+      replLen = 0;
+    }
+    v.dirPtr_->Remove(dN, len, replRoute, replLen);
+  }
+} // end RouteTable::Drop()
+
+RouteTable::RouteVersion* RouteTable::BeginUpdate (bool copy)
+{
+  updateMutex_.lock();
+  RouteVersion* v = current_.load(std::memory_order_relaxed);
+  if (epochs_.LockIdle())  // no reader can see v until EndUpdate
+    return v;
+  return copy ? Copy(*v) : new RouteVersion(sizeEstimate_, engine_ == dirEngine);
+} // end RouteTable::BeginUpdate()
+
+void RouteTable::EndUpdate (RouteVersion* v)
+{
+  v->generation_ = ++generation_;
+  if (v == current_.load(std::memory_order_relaxed))
+    epochs_.UnlockIdle();
+  else
+  {
+    Retired r;
+    r.version_ = current_.exchange(v, std::memory_order_seq_cst);
+    r.epoch_ = epochs_.Retire();
+    retired_.push_back(r);
+  }
+  Reclaim(0);
+  updateMutex_.unlock();
+} // end RouteTable::EndUpdate()
+
+RouteTable::RouteVersion* RouteTable::Copy (const RouteVersion& v) const
+// a new version with the routes of v, built as Load() would
+{
+  TableType::Iterator i;
+  std::vector < EntryType > hosts;
+  std::vector < uint32_t > prefixes;
+
+  RouteVersion* copy = new RouteVersion(v.tablePtr_->Size() > sizeEstimate_
+                                        ? (uint32_t)v.tablePtr_->Size() : sizeEstimate_,
+                                        v.dirPtr_ != 0);
+  hosts.reserve(v.tablePtr_->Size());
+  for (i = v.tablePtr_->Begin(); i != v.tablePtr_->End(); ++i)
+    hosts.push_back(*i);
+  AddHosts(*copy, hosts);
+  PrefixCollector pc(prefixes);
+  v.triePtr_->Traverse(pc);
+  for (size_t p = 0; p < prefixes.size(); p += 3)
+    Add(*copy, prefixes[p], prefixes[p + 2], prefixes[p + 1]);
+  return copy;
+} // end RouteTable::Copy()
+
+void RouteTable::Reclaim (bool all)
+// frees the retired versions no reader can still be using (all of them
+// when there are no readers)
+{
+  size_t kept = 0;
+  for (size_t r = 0; r < retired_.size(); ++r)
+  {
+    if (all || epochs_.Safe(retired_[r].epoch_))
+      delete retired_[r].version_;
+    else
+      retired_[kept++] = retired_[r];
+  }
+  retired_.resize(kept);
+} // end RouteTable::Reclaim()
+
 ipClass RouteTable::ipInterpret (const ipNumber& address, ipNumber& netID, ipNumber& hostID)
 // returns ipClass and sets netID and hostID of address
 //           (bits numberd left to right beginning with 0)
@@ -144,141 +532,268 @@ ipClass RouteTable::ipInterpret (const ipNumber& address, ipNumber& netID, ipNum
 ipNumber RouteTable::ipS2ipN (const ipString& S)
 // ipString (dot notation) to ipNumber
 {
-  uint32_t byte1(0), byte2(0), byte3(0), byte4(0);
-  size_t i = 0, size = S.Size();
+  return ipS2ipN(S.Cstr(), S.Size());
+}
+
+ipNumber RouteTable::ipS2ipN (const char* S, size_t size)
+// dot notation to ipNumber, reporting syntax errors to std::cerr
+{
+  ipNumber ipn;
+  unsigned field;
 
-  // byte1
-  if (i == size || S[i] < '0' || S[i] > '9')
+  switch (ipParse(S, size, ipn, field))
   {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- digit expected at begin of field 1.\n";
-    return 0;
+    case ipOK:
+      return ipn;
+    case ipDigitExpected:
+      std::cerr << "** ipS2ipN(): ipString syntax error -- digit expected at begin of field " << field << ".\n";
+      break;
+    case ipFieldRange:
+      std::cerr << "** ipS2ipN(): ipString error -- field " << field << " excedes max 255\n";
+      break;
+    case ipDotExpected:
+      std::cerr << "** ipS2ipN(): ipString syntax error -- '.' expected at end of field " << field << ".\n";
+      break;
+    case ipTrailing:
+      std::cerr << "** ipS2ipN(): ipString syntax error.\n";
+      break;
   }
+  return 0;
+} // end ipS2ipN()
 
-  while (i < size && S[i] >= '0' && S[i] <= '9')
-  {
-    byte1 = byte1*10 + (S[i] - '0');
+#if defined(__SSSE3__) && defined(__GNUC__)
+
+// Vectorized dot notation parsing.
+//
+// The string (7..15 chars) is loaded into one 16-byte register. Dot and
+// digit positions are found with byte compares, and the positions of the
+// three dots give the lengths (1..3) of the four fields. Each of the 81
+// length combinations has a shuffle pattern that moves the digits of
+// field f to bytes 4f..4f+2 as hundreds, tens, ones (zero when absent);
+// multiply-adds with weights 100,10,1,0 then give the four field values
+// as 32-bit lanes, which are range checked and packed into the ipNumber.
+// Anything unusual (leading zeros making a field longer than 3 digits,
+// a field > 255, a syntax error) returns 0 and is left to the scalar
+// parser, which also produces the exact status.
+
+class ipShuffleTable
+{
+public:
+  uint8_t pattern_[81][16];
+  ipShuffleTable ();
+} ;
 
-    if (byte1 > 255)
+ipShuffleTable::ipShuffleTable ()
+{
+  unsigned len[4], start, f, i;
+  for (unsigned c = 0; c < 81; ++c)
+  {
+    len[0] = c / 27 + 1;
+    len[1] = (c / 9) % 3 + 1;
+    len[2] = (c / 3) % 3 + 1;
+    len[3] = c % 3 + 1;
+    for (i = 0; i < 16; ++i)
+      pattern_[c][i] = 0x80; // shuffle to zero
+    start = 0;
+    for (f = 0; f < 4; ++f)
     {
-      std::cerr << "** ipS2ipN(): ipString error -- field 1 excedes max 255\n";
-      return 0;
+      unsigned ones = start + len[f] - 1;
+      pattern_[c][4*f + 2] = (uint8_t)ones;
+      if (len[f] >= 2) pattern_[c][4*f + 1] = (uint8_t)(ones - 1);
+      if (len[f] == 3) pattern_[c][4*f + 0] = (uint8_t)(ones - 2);
+      start += len[f] + 1;
     }
-
-    i++;
   }
+}
 
-  if (i == size || S[i] != '.')
-  {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- '.' expected at end of field 1.\n";
+static const ipShuffleTable ipShuffle;
+
+static inline bool ipParseSSE (const char* S, size_t size, ipNumber& ipn)
+{
+  if (size < 7 || size > 15)
     return 0;
+
+  __m128i v;
+  if (((uintptr_t)S & 4095) <= 4096 - 16) // 16-byte load stays in the page
+    v = _mm_loadu_si128((const __m128i*)S);
+  else
+  {
+    char buffer[16] = { 0 };
+    std::memcpy(buffer, S, size);
+    v = _mm_loadu_si128((const __m128i*)buffer);
   }
 
-  i++;
+  const unsigned sizeMask = (1u << size) - 1;
+  __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+  unsigned dots   = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.'))) & sizeMask;
+  unsigned digits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d)) & sizeMask;
+  if ((dots | digits) != sizeMask || __builtin_popcount(dots) != 3)
+    return 0;
 
-  // byte2
-  if (i == size || S[i] < '0' || S[i] > '9')
-  {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- digit expected at begin of field 2.\n";
+  unsigned p1 = __builtin_ctz(dots);  dots &= dots - 1;
+  unsigned p2 = __builtin_ctz(dots);  dots &= dots - 1;
+  unsigned p3 = __builtin_ctz(dots);
+  unsigned l1 = p1, l2 = p2 - p1 - 1, l3 = p3 - p2 - 1, l4 = (unsigned)size - p3 - 1;
+  if (l1 - 1 > 2 || l2 - 1 > 2 || l3 - 1 > 2 || l4 - 1 > 2) // unsigned: catches 0 too
+    return 0;
+
+  __m128i pattern = _mm_loadu_si128((const __m128i*)ipShuffle.pattern_[(l1-1)*27 + (l2-1)*9 + (l3-1)*3 + (l4-1)]);
+  __m128i placed  = _mm_shuffle_epi8(d, pattern);
+  __m128i pairs   = _mm_maddubs_epi16(placed, _mm_set1_epi32(0x00010A64)); // 100,10,1,0
+  __m128i fields  = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+  if (_mm_movemask_epi8(_mm_cmpgt_epi32(fields, _mm_set1_epi32(255))) != 0)
     return 0;
+
+  __m128i packed = _mm_shuffle_epi8(fields, _mm_setr_epi8(12, 8, 4, 0, -128, -128, -128, -128,
+                                                          -128, -128, -128, -128, -128, -128, -128, -128));
+  ipn = (ipNumber)_mm_cvtsi128_si32(packed);
+  return 1;
+}
+
+#endif
+
+ipStatus RouteTable::ipParse (const char* S, size_t size, ipNumber& ipn, unsigned& field)
+// dot notation to ipNumber without output
+{
+#if defined(__SSSE3__) && defined(__GNUC__)
+  if (ipParseSSE(S, size, ipn))
+  {
+    field = 4;
+    return ipOK;
   }
+#endif
 
-  while (i < size && S[i] >= '0' && S[i] <= '9')
+  uint32_t byte, result = 0;
+  size_t i = 0;
+
+  ipn = 0;
+  for (field = 1; field <= 4; ++field)
   {
-    byte2 = byte2*10 + (S[i] - '0');
+    if (i == size || S[i] < '0' || S[i] > '9')
+      return ipDigitExpected;
 
-    if (byte2 > 255)
+    byte = 0;
+    while (i < size && S[i] >= '0' && S[i] <= '9')
     {
-      std::cerr << "** ipS2ipN(): ipString error -- field 2 excedes max 255\n";
-      return 0;
+      byte = byte*10 + (S[i] - '0');
+      if (byte > 255)
+        return ipFieldRange;
+      i++;
     }
+    result = (result << 8) | byte;
 
-    i++;
+    if (field < 4)
+    {
+      if (i == size || S[i] != '.')
+        return ipDotExpected;
+      i++;
+    }
   }
+  field = 4;
 
-  if (i == size || S[i] != '.')
-  {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- '.' expected at end of field 2.\n";
-    return 0;
-  }
+  // check that we used all of S
+  if (i != size)
+    return ipTrailing;
 
-  i++;
+  ipn = result;
+  return ipOK;
+} // end ipParse()
 
-  // byte3
-  if (i == size || S[i] < '0' || S[i] > '9')
+size_t RouteTable::ipParseBulk (const char* const* S, const size_t* size, ipNumber* ipn,
+                                ipStatus* status, size_t n)
+// ipParse() for n strings; ipn[i] is 0 where status[i] is not ipOK
+// returns the number of strings converted
+{
+  size_t count = 0;
+  unsigned field;
+  for (size_t i = 0; i < n; ++i)
   {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- digit expected at begin of field 3.\n";
-    return 0;
+    status[i] = ipParse(S[i], size[i], ipn[i], field);
+    if (status[i] == ipOK)
+      ++count;
   }
+  return count;
+} // end ipParseBulk()
 
-  while (i < size && S[i] >= '0' && S[i] <= '9')
-  {
-    byte3 = byte3*10 + (S[i] - '0');
 
-    if (byte1 > 255)
+bool RouteTable::ipS2Prefix (const ipString& S, ipNumber& prefix, uint32_t& len)
+// ipString (dot notation with optional "/len") to prefix and length
+{
+  char address[16];
+  size_t i = 0, size = S.Size();
+
+  while (i < size && S[i] != '/')
+  {
+    if (i == 15)
     {
-      std::cerr << "** ipS2ipN(): ipString error -- field 3 excedes max 255\n";
+      std::cerr << "** ipS2Prefix(): ipString syntax error -- address too long\n";
       return 0;
     }
-
+    address[i] = S[i];
     i++;
   }
+  address[i] = '\0';
 
-  if (i == size || S[i] != '.')
-  {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- '.' expected at end of field 3.\n";
-    return 0;
-  }
+  prefix = ipS2ipN(ipString(address));
+  if (prefix == 0 && std::strcmp(address, "0.0.0.0") != 0)
+    return 0; // ipS2ipN() has reported the error
 
-  i++;
+  len = 32;
+  if (i == size)
+    return 1;
 
-  // byte4
-  if (i == size || S[i] < '0' || S[i] > '9')
+  // prefix length
+  i++;
+  if (i == size)
   {
-    std::cerr << "** ipS2ipN(): ipString syntax error -- digit expected at begin of field 4.\n";
+    std::cerr << "** ipS2Prefix(): ipString syntax error -- digit expected after '/'\n";
     return 0;
   }
 
-  while (i < size && S[i] >= '0' && S[i] <= '9')
+  len = 0;
+  while (i < size)
   {
-    byte4 = byte4*10 + (S[i] - '0');
-
-    if (byte4 > 255)
+    if (S[i] < '0' || S[i] > '9')
     {
-      std::cerr << "** ipS2ipN(): ipString error -- field 4 excedes max 255\n";
+      std::cerr << "** ipS2Prefix(): ipString syntax error -- digit expected after '/'\n";
+      return 0;
+    }
+    len = len*10 + (S[i] - '0');
+    if (len > 32)
+    {
+      std::cerr << "** ipS2Prefix(): ipString error -- prefix length excedes max 32\n";
       return 0;
     }
-
     i++;
   }
 
-  // check that we used all of S
-  if (i != size)
+  if (RouteTrie::Mask(prefix, len) != prefix)
   {
-    std::cerr << "** ipS2ipN(): ipString syntax error.\n";
+    std::cerr << "** ipS2Prefix(): ipString error -- address bits set beyond prefix length\n";
     return 0;
   }
-
-  // assemble and return ipNumber
-  return (byte1 << 24) | (byte2 << 16) | (byte3 << 8) | byte4;
-} // end ipS2ipN()
+  return 1;
+} // end ipS2Prefix()
 
 
 // *****  below this line are complete *****
 
 std::ostream& operator << (std::ostream& os, ipClass ipC)
+{
+  os.put(ipLetter(ipC));
+  return os;
+}
+
+char ipLetter (ipClass ipC)
 {
   switch(ipC)
   {
-    case classA:
-      os.put('A'); break;
-    case classB:
-      os.put('B'); break;
-    case classC:
-      os.put('C'); break;
-    case badClass:
-      os.put('D'); break;
+    case classA:   return 'A';
+    case classB:   return 'B';
+    case classC:   return 'C';
+    case badClass: return 'D';
   }
-  return os;
+  return 'D';
 }
 
 uint64_t ipHash::operator () (const ipNumber& ipn) const
@@ -286,31 +801,77 @@ uint64_t ipHash::operator () (const ipNumber& ipn) const
   return hashfunction::KISS (ipn);
 }
 
-RouteTable::RouteTable  (uint32_t sizeEstimate) : tablePtr_(0)
+// load factors for the /32 table: grow past one entry per bucket, shrink
+// below one per four
+static const double maxLoad = 1.0;
+static const double minLoad = 0.25;
+
+RouteTable::RouteVersion::RouteVersion (uint32_t sizeEstimate, bool dir)
+  : tablePtr_(0), triePtr_(0), dirPtr_(0), generation_(0)
 {
-  ipHash iph;
-  tablePtr_ = new TableType  (sizeEstimate, iph);
+  HashType hfo;
+  tablePtr_ = new TableType  (sizeEstimate, hfo);
+  // sizeEstimate is only a starting point
+  tablePtr_->SetLoadFactors(maxLoad, minLoad);
+  triePtr_  = new RouteTrie;
+  if (dir)
+    dirPtr_ = new DirTable;
 }
 
-RouteTable::~RouteTable ()
+RouteTable::RouteVersion::~RouteVersion ()
 {
   delete tablePtr_;
+  delete triePtr_;
+  delete dirPtr_;
 }
 
-void RouteTable::Clear()
+void RouteTable::RouteVersion::Clear ()
 {
   tablePtr_->Clear();
+  triePtr_->Clear();
+  if (dirPtr_ != 0)
+    dirPtr_->Clear();
+}
+
+RouteTable::RouteTable  (uint32_t sizeEstimate, RouteEngine engine)
+  : current_(0), generation_(0), sizeEstimate_(sizeEstimate), engine_(engine),
+    threads_(1), format_(textLog)
+{
+  current_.store(new RouteVersion(sizeEstimate, engine == dirEngine));
+}
+
+RouteTable::~RouteTable ()
+{
+  Reclaim(1);
+  delete current_.load();
+}
+
+void RouteTable::Clear()
+{
+  RouteVersion* v = BeginUpdate(0);
+  v->Clear();
+  EndUpdate(v);
 }
 
 void RouteTable::Dump(const char* dumpfile)
 {
+  EpochReader reader(epochs_);
+  const RouteVersion& v = *current_.load(std::memory_order_seq_cst);
   if (dumpfile == 0)
   {
     std::cout.setf(std::ios::uppercase);
-    std::cout << "\nSize(): " << std::dec << tablePtr_->Size() << std::hex
+    std::cout << "\nSize(): " << std::dec << v.tablePtr_->Size()
+              << "  LoadFactor(): " << v.tablePtr_->LoadFactor()
+              << "  ResizeCount(): " << v.tablePtr_->ResizeCount() << std::hex
               << "\nDump():\n";
     std::cout.fill('0');
-    tablePtr_->Dump(std::cout,8,8);
+    v.tablePtr_->Dump(std::cout,8,8);
+    std::cout << "\nPrefixes(): " << std::dec << v.triePtr_->Size() << std::hex << '\n';
+    PrefixWriter pw(std::cout, ':');
+    v.triePtr_->Traverse(pw);
+    if (v.dirPtr_ != 0)
+      std::cout << "\nDIR-24-8 blocks: " << std::dec << v.dirPtr_->Blocks()
+                << " memory: " << v.dirPtr_->Footprint() << " bytes\n" << std::hex;
     std::cout.fill(' ');
   }
 
@@ -325,131 +886,344 @@ void RouteTable::Dump(const char* dumpfile)
       return;
     }
     out1.setf(std::ios::uppercase);
-    out1 << "\nSize(): " << std::dec << tablePtr_->Size() << std::hex
+    out1 << "\nSize(): " << std::dec << v.tablePtr_->Size()
+         << "  LoadFactor(): " << v.tablePtr_->LoadFactor()
+         << "  ResizeCount(): " << v.tablePtr_->ResizeCount() << std::hex
          << "\nDump():\n";
 
     out1.fill('0');
-    tablePtr_->Dump(out1,8,8);
+    v.tablePtr_->Dump(out1,8,8);
+    out1 << "\nPrefixes(): " << std::dec << v.triePtr_->Size() << std::hex << '\n';
+    PrefixWriter pw(out1, ':');
+    v.triePtr_->Traverse(pw);
+    if (v.dirPtr_ != 0)
+      out1 << "\nDIR-24-8 blocks: " << std::dec << v.dirPtr_->Blocks()
+           << " memory: " << v.dirPtr_->Footprint() << " bytes\n" << std::hex;
     out1.close();
   }
 } // end RouteTable::Dump()
 
+void RouteTable::Analysis() const
+{
+  EpochReader reader(epochs_);
+  const RouteVersion& v = *current_.load(std::memory_order_seq_cst);
+  std::cout << "\nHash table analysis (exact /32 destinations):\n";
+  v.tablePtr_->Analysis(std::cout);
+  std::cout << "Prefix trie: " << std::dec << v.triePtr_->Size() << " prefixes, "
+            << v.triePtr_->Nodes() << " nodes\n";
+  if (v.dirPtr_ != 0)
+    std::cout << "DIR-24-8 blocks: " << v.dirPtr_->Blocks()
+              << " memory: " << v.dirPtr_->Footprint() << " bytes\n";
+  std::cout << '\n';
+} // end RouteTable::Analysis()
+
 void RouteTable::Go (const char* msgfile, const char* logfile)
 {
-  std::ifstream fin;
+  MsgReader in;
   std::ofstream fout;
-  fin.open(msgfile);
-  if (fin.fail())
+  if (!in.Open(msgfile))
   {
     std::cerr << "** RouteTable: unable to open msg file " << msgfile << '\n'
               << "   Go() aborted\n";
     return;
   }
 
-  if (logfile == 0) // log to standard output
+  if (logfile != 0) // else log to standard output
   {
-    fin >> std::hex;
-    std::cout << std::hex << std::uppercase;
-    ipClass ipC;
-    ipString dS;
-    ipNumber dN, rN, netID, hostID;
-    fsu::String msgID;
-
-    std::cout << "  Router simulation started\n";
-    fin >> dS >> msgID;
-    while (!fin.fail())
-    {
-      dN = ipS2ipN(dS);
-      ipC = ipInterpret (dN, netID, hostID);
-      if (ipC == badClass)
-      {
-        std::cout << "msgID: " << std::setw(5) << msgID
-                  << std::setfill('0')
-                  << " dest: " << std::setw(8)<< dN
-                  << " NOT ROUTED -- BAD IP CLASS\n"
-                  << std::setfill(' ');
-      }
-      else if (tablePtr_->Retrieve(dN,rN))
-      {
-        ipC = ipInterpret (rN, netID, hostID);
-        std::cout << "msgID: " << std::setw(5) << msgID
-                  << std::setfill('0')
-                  << " dest: " << std::setw(8)<< dN
-                  << " route class: " << ipC
-                  << " netID: " << std::setw(8) << netID
-                  << " hostID: " << std::setw(8) << hostID << '\n'
-                  << std::setfill(' ');
-      }
-      else
-      {
-        std::cout << "msgID: " << std::setw(5) << msgID
-                  << std::setfill('0')
-                  << " dest: " << std::setw(8)<< dN
-                  << " NOT ROUTED -- NO TABLE ENTRY\n"
-                  << std::setfill(' ');
-      }
-      fin >> dS >> msgID;
-    } // end while()
-    fin.close();
-    std::cout << "  Router simulation stopped\n";
-  }  // end if
-  else // log to file
-  {
-    fout.open(logfile);
+    fout.open(logfile, format_ == binaryLog ? std::ios::out | std::ios::binary : std::ios::out);
     if (fout.fail())
     {
       std::cerr << "** RouteTable: unable to open log file " << logfile << '\n'
                 << "   Go() aborted\n";
       return;
     }
+  }
+  std::ostream& out = (logfile == 0) ? std::cout : fout;
 
-    fin >> std::hex;
-    fout << std::hex << std::uppercase;
-    ipClass ipC;
-    ipString dS;
-    ipNumber dN, rN, netID, hostID;
-    fsu::String msgID;
+  std::cout << "  Router simulation started\n";
+  stats_.Clear();
+  Clock::time_point start = Clock::now();
+  switch (format_)
+  {
+    case textLog:   Run<TextSink>(in, out);   break;
+    case binaryLog: Run<BinarySink>(in, out); break;
+    case countLog:  Run<CountSink>(in, out);  break;
+    case nullLog:   Run<NullSink>(in, out);   break;
+  }
+
+  in.Close();
+  if (logfile != 0)
+    fout.close();
+  stats_.seconds_ = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "  Router simulation stopped\n";
+  stats_.Report(std::cout);
+} // end RouteTable::Go()
+
+void RouteTable::Stats (const char* statsfile) const
+{
+  if (!stats_.Write(statsfile))
+  {
+    std::cerr << "** RouteTable: unable to open stats file " << statsfile << '\n'
+              << "   Stats() aborted\n";
+    return;
+  }
+  std::cout << "  Stats() completed\n";
+}
+
+void RouteTable::SetThreads (unsigned numThreads)
+{
+  threads_ = (numThreads == 0) ? 1 : numThreads;
+  if (!caches_.empty())
+    caches_.resize(threads_, RouteCache(caches_[0].Sets()));
+}
+
+void RouteTable::SetCache (size_t sets)
+{
+  caches_.clear();
+  if (sets > 0)
+    caches_.resize(threads_, RouteCache(sets));
+}
+
+void RouteTable::SetLogFormat (LogFormat format)
+{
+  format_ = format;
+}
+
+template <class S>
+void RouteTable::Run (MsgReader& in, std::ostream& out)
+{
+  S sink;
+  if (threads_ > 1)
+    GoParallel(in, out, stats_, sink);
+  else
+  {
+    sink.Open(out);
+    Route(in, sink, stats_, caches_.empty() ? 0 : &caches_[0]);
+    sink.Close();
+  }
+  sink.Summary(out);
+
+  // this run's readers have left: free the versions retired while it ran
+  // rather than keeping them until the next update
+  std::lock_guard<std::mutex> lock(updateMutex_);
+  Reclaim(0);
+}
+
+static inline uint64_t Nanoseconds (Clock::duration d)
+{
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+// the result of a lookup, as RouteCache keeps it
+static inline void Resolve (bool found, ipNumber rN, RouteResult& result)
+{
+  result.found_ = found;
+  if (found)
+  {
+    result.route_ = rN;
+    result.class_ = ipLetter(RouteTable::ipInterpret(rN, result.netID_, result.hostID_));
+  }
+}
 
-    std::cout << "  Router simulation started\n";
-    fin >> dS >> msgID;
-    while (!fin.fail())
+template <class S>
+void RouteTable::Route (MsgReader& in, S& sink, RouteStats& stats, RouteCache* cache) const
+// messages are read and looked up in blocks so that the table lookups
+// of a block can overlap (see LookupBatch); the tokens of a block point
+// into the reader's window, so a block never spans a Refill(); one block
+// in RouteStats::sampleInterval is timed; with a cache only the misses
+// of a block are looked up; each block is looked up in the version
+// current when its lookup begins
+{
+  const size_t blockSize = 64;
+  ipClass ipC;
+  const char * dS[blockSize], * msgID[blockSize];
+  size_t dSize[blockSize], idSize[blockSize];
+  ipNumber dN[blockSize], rN[blockSize], missN[blockSize], netID, hostID;
+  ipStatus status[blockSize];
+  uint8_t found[blockSize];
+  size_t miss[blockSize];
+  RouteResult result[blockSize];
+  size_t n, m, i, j;
+  bool timed;
+  Clock::time_point t0, t1, t2, t3;
+  const RouteVersion * v;
+  size_t slot = epochs_.Join();
+
+  do
+  {
+    do
     {
-      dN = ipS2ipN(dS);
-      ipC = ipInterpret (dN, netID, hostID);
-      if (ipC == badClass)
+      timed = (stats.blocks_ % RouteStats::sampleInterval == 0);
+      if (timed) t0 = Clock::now();
+
+      for (n = 0; n < blockSize; ++n)
+        if (!in.Next(dS[n], dSize[n], msgID[n], idSize[n]))
+          break;
+
+      if (ipParseBulk(dS, dSize, dN, status, n) != n)
       {
-        fout << "msgID: " << std::setw(5) << msgID
-             << std::setfill('0')
-             << " dest: " << std::setw(8)<< dN
-             << " NOT ROUTED -- BAD IP CLASS\n"
-             << std::setfill(' ');
+        sink.Flush(); // keep the error reports in order with the log
+        for (i = 0; i < n; ++i)
+          if (status[i] != ipOK)
+            ipS2ipN(dS[i], dSize[i]); // report the error
       }
-      else if (tablePtr_->Retrieve(dN, rN))
+
+      if (timed) t1 = Clock::now();
+      epochs_.Enter(slot);
+      v = current_.load(std::memory_order_seq_cst);
+      if (cache == 0)
       {
-        ipC = ipInterpret (rN, netID, hostID);
-        fout << "msgID: " << std::setw(5) << msgID
-             << std::setfill('0')
-             << " dest: " << std::setw(8)<< dN
-             << " route class: " << ipC
-             << " netID: " << std::setw(8) << netID
-             << " hostID: " << std::setw(8) << hostID << '\n'
-             << std::setfill(' ');
+        LookupBatch(*v, dN, rN, found, n);
+        for (i = 0; i < n; ++i)
+          Resolve(found[i], rN[i], result[i]);
       }
       else
       {
-        fout << "msgID: " << std::setw(5) << msgID
-             << std::setfill('0')
-             << " dest: " << std::setw(8)<< dN
-             << " NOT ROUTED -- NO TABLE ENTRY\n"
-             << std::setfill(' ');
+        cache->Revalidate(v->generation_);
+        for (m = 0, i = 0; i < n; ++i)
+          if (!cache->Find(dN[i], result[i]))
+          {
+            miss[m] = i;
+            missN[m++] = dN[i];
+          }
+        LookupBatch(*v, missN, rN, found, m);
+        for (j = 0; j < m; ++j)
+        {
+          Resolve(found[j], rN[j], result[miss[j]]);
+          cache->Store(missN[j], result[miss[j]]);
+        }
+        stats.cacheHits_ += n - m;
+        stats.cacheMisses_ += m;
       }
-      fin >> dS >> msgID;
-    } // end while()
+      epochs_.Exit(slot);
+      if (timed) t2 = Clock::now();
 
-    fin.close();
-    fout.close();
-    std::cout << "  Router simulation stopped\n";
+      for (i = 0; i < n; ++i)
+      {
+        ipC = ipInterpret (dN[i], netID, hostID);
+        if (ipC == badClass)
+        {
+          sink.BadClass(msgID[i], idSize[i], dN[i]);
+          ++stats.badClass_;
+        }
+        else if (result[i].found_)
+        {
+          sink.Routed(msgID[i], idSize[i], dN[i], result[i].route_, result[i].class_,
+                      result[i].netID_, result[i].hostID_);
+          ++stats.routed_;
+        }
+        else
+        {
+          sink.NoEntry(msgID[i], idSize[i], dN[i]);
+          ++stats.noEntry_;
+        }
+      }
 
-  } // end else
-  return;
-} // end RouteTable::Go()
+      if (n > 0)
+      {
+        ++stats.blocks_;
+        if (timed)
+        {
+          t3 = Clock::now();
+          stats.stage_[parseStage].Record(Nanoseconds(t1 - t0) / n, n);
+          stats.stage_[lookupStage].Record(Nanoseconds(t2 - t1) / n, n);
+          stats.stage_[formatStage].Record(Nanoseconds(t3 - t2) / n, n);
+        }
+      }
+    }
+    while (n == blockSize);
+  }
+  while (in.Refill());
+  epochs_.Leave(slot);
+} // end RouteTable::Route()
+
+template <class S>
+void RouteTable::RouteChunk (const char* begin, const char* end, std::string& log,
+                             RouteStats& stats, S& sink, RouteCache* cache) const
+{
+  MsgReader in;
+  std::ostringstream out;
+  in.Attach(begin, end);
+  sink.Open(out);
+  Route(in, sink, stats, cache);
+  sink.Close();
+  log = out.str();
+}
+
+// Sets up to text.size() chunks [begin[t], end[t]) of whole lines, of
+// about chunkSize bytes each, and returns the number set. A mapped
+// window is cut in place; otherwise each chunk is a Refill() of the
+// reader copied to text[t].
+static size_t NextChunks (MsgReader& in, std::vector<std::string>& text,
+                          std::vector<const char*>& begin, std::vector<const char*>& end,
+                          size_t chunkSize)
+{
+  size_t t;
+  if (in.Mapped())
+  {
+    const char * p = in.Pos(), * e = in.End(), * q;
+    for (t = 0; t < text.size() && p < e; ++t)
+    {
+      q = ((size_t)(e - p) > chunkSize) ? p + chunkSize : e;
+      q = (const char*) std::memchr(q, '\n', e - q);
+      q = (q == 0) ? e : q + 1;
+      begin[t] = p;
+      end[t] = q;
+      p = q;
+    }
+    in.Skip(p);
+    return t;
+  }
+  for (t = 0; t < text.size() && in.Refill(); ++t)
+  {
+    text[t].assign(in.Pos(), in.End());
+    begin[t] = text[t].data();
+    end[t] = begin[t] + text[t].size();
+  }
+  return t;
+}
+
+template <class S>
+void RouteTable::GoParallel (MsgReader& in, std::ostream& out, RouteStats& stats,
+                             S& sink) const
+// The message file is cut into chunks of whole lines. Each round, one
+// chunk per thread is routed into a private log string while the next
+// round of chunks is set up; the logs are then written in chunk order,
+// so the output is the same as that of the single-threaded Route().
+// Each thread keeps its own RouteStats and sink, merged into stats and
+// sink at the end.
+{
+  const size_t chunkSize = 1 << 22;
+  std::vector<std::string> text(threads_), nextText(threads_), log(threads_);
+  std::vector<RouteStats> threadStats(threads_);
+  std::vector<S> threadSink(threads_);
+  std::vector<const char*> begin(threads_), end(threads_), nextBegin(threads_), nextEnd(threads_);
+  std::vector<std::thread> worker;
+  size_t count, nextCount, t;
+
+  count = NextChunks(in, text, begin, end, chunkSize);
+  while (count > 0)
+  {
+    worker.clear();
+    for (t = 0; t < count; ++t)
+      worker.push_back(std::thread(&RouteTable::RouteChunk<S>, this,
+                                   begin[t], end[t], std::ref(log[t]),
+                                   std::ref(threadStats[t]), std::ref(threadSink[t]),
+                                   caches_.empty() ? (RouteCache*)0 : &caches_[t]));
+    nextCount = NextChunks(in, nextText, nextBegin, nextEnd, chunkSize);
+    for (t = 0; t < count; ++t)
+    {
+      worker[t].join();
+      out.write(log[t].data(), log[t].size());
+    }
+    text.swap(nextText);
+    begin.swap(nextBegin);
+    end.swap(nextEnd);
+    count = nextCount;
+  }
+  for (t = 0; t < threads_; ++t)
+  {
+    stats.Merge(threadStats[t]);
+    sink.Merge(threadSink[t]);
+  }
+} // end RouteTable::GoParallel()
@@ -12,6 +12,54 @@
     The data are entered manually in ipStrings, which are converted to
     ipNumbers before insertion in the table.
 
+    A destination may also be a CIDR prefix N1.N2.N3.N4/len, len in the
+    range 0..32, which routes every address whose leading len bits match
+    the prefix. Full /32 destinations are kept in an exact-match hash
+    table; shorter prefixes are kept in a RouteTrie (see iptrie.h).
+    Lookup first tries the hash table and then takes the longest matching
+    prefix from the trie. In files a prefix is written in hex followed by
+    a decimal length, as in C0A80000/16.
+
+    SaveBinary and LoadBinary use a binary snapshot instead of text:
+
+      header   "IPRT", version, byte order mark 0x01020304, reserved,
+               host count, prefix count, checksum (64-bit each)
+      hosts    host count   packed (dest, route) ipNumber pairs
+      prefixes prefix count packed (prefix, route, len) triples
+
+    in native byte order, with the checksum an FNV-1a hash over the
+    32-bit words of the records. LoadBinary maps the file, checks it,
+    presizes the hash table for the host count and then inserts the
+    records in one pass.
+
+    RouteTable can alternatively be constructed with the dirEngine,
+    which additionally keeps every route in a DirTable (see ipdir.h), a
+    DIR-24-8 array resolving any address in at most two memory reads.
+    The hash table and trie remain the record of the entries; the
+    DirTable is updated incrementally from them on Insert and Remove.
+
+    Go() counts the messages routed and not routed and samples the time
+    per message spent parsing, looking up and formatting (see ipstats.h).
+    The counts and timing are printed when Go() finishes, and Stats()
+    writes them to a file.
+    Go() hands each message to a sink chosen by SetLogFormat(): the text
+    log (default), binary records, route counts only, or nothing at all
+    (see iplog.h). The routing loop is a template on the sink type.
+
+    SetCache(sets) gives Go() a RouteCache per thread (see ipcache.h),
+    emptied whenever the routes change; SetCache(0) turns it off (the
+    default). Hits and misses are part of the statistics.
+
+    Updates may run while Go() is forwarding. The hash table, trie and
+    DirTable form a RouteVersion, which readers never see change: Go()
+    threads read the current version without locks, and an update
+    (Insert, Remove, Load, LoadBinary, Clear) builds a new version from
+    the current one, applies its changes there and publishes it with one
+    atomic pointer exchange. The old version is freed once every reader
+    has passed the end of its current block (see iprcu.h). Updates are
+    serialized among themselves. When no reader is active an update is
+    made in place, so a table being loaded before Go() is never copied.
+
     ipString is the familier "dot" notation N1.N2.N3.N4 where Ni is a
     decimal in the range 0..255, interpreted as a byte.
     ipString is stored as a String object.
@@ -50,14 +98,25 @@
 
 #include <iostream>
 #include <fstream>
+#include <string>
+#include <vector>
 #include <stdint.h>
 
 #include <xstring.h>
 #include <hashfunctions.h>
 #include <hashtbl.h>
+#include <ohashtbl.h>
 #include <list.h>
+#include <ipnum.h>
+#include <iptrie.h>
+#include <ipdir.h>
+#include <ipmsg.h>
+#include <iphash.h>
+#include <ipstats.h>
+#include <iplog.h>
+#include <ipcache.h>
+#include <iprcu.h>
 
-typedef uint32_t      ipNumber;  // 32-bit register
 typedef fsu::String   ipString;  // "dot" notation
 
 class ipHash;
@@ -68,6 +127,21 @@ enum ipClass
    classA, classB, classC, badClass
 } ;
 
+enum ipStatus
+{
+   ipOK, ipDigitExpected, ipDotExpected, ipFieldRange, ipTrailing
+} ;
+
+enum RouteEngine
+{
+   trieEngine, dirEngine
+} ;
+
+enum LogFormat
+{
+   textLog, binaryLog, countLog, nullLog
+} ;
+
 class ipHash
 {
   public:
@@ -77,18 +151,34 @@ class ipHash
 std::ostream& operator << (std::ostream& os, ipClass ipc);
 // sends 'A', 'B', 'C', or 'D' to os depending on ipClass value
 
+char ipLetter (ipClass ipc);
+// the letter operator << sends
+
 class RouteTable
 {
 public:  // member functions:
 
   void Load          (const char* loadfile);
   void Save          (const char* savefile);
+  void LoadBinary    (const char* loadfile);
+  void SaveBinary    (const char* savefile);
   void Insert        (const ipString& dS, const ipString& rS);
   void Remove        (const ipString& dS);
+  bool Lookup        (const ipNumber& dN, ipNumber& rN) const;
+  void LookupBatch   (const ipNumber* dN, ipNumber* rN, uint8_t* found, size_t n) const;
   void Go            (const char* msgfile, const char* logfile);
+  void SetThreads    (unsigned numThreads);
+  // Go() routes on numThreads worker threads when numThreads > 1;
+  // the message file must then have one message per line
+  void Stats         (const char* statsfile) const;
+  // writes the counts and timing of the last Go() (see ipstats.h)
+  void SetLogFormat  (LogFormat format);
+  void SetCache      (size_t sets);
   void Clear         ();
   void Dump          (const char* dumpfile);
-       RouteTable    (uint32_t sizeEstimate);
+  void Analysis      () const;
+  // hash table statistics (see hashtbl.h), trie and DIR-24-8 sizes
+       RouteTable    (uint32_t sizeEstimate, RouteEngine engine = trieEngine);
        ~RouteTable   ();
 
 public:  // static member functions:
@@ -105,20 +195,99 @@ public:  // static member functions:
     // return:  the ipClass of the address
 
   static ipNumber ipS2ipN (const ipString& S);
-  // converts ipString to ipNumber
+  static ipNumber ipS2ipN (const char* S, size_t size);
+  // converts ipString (or the size characters at S) to ipNumber
   // checks for correct "dot" notation syntax and field sizes
+  // (errors are reported to std::cerr and 0 is returned)
+
+  static ipStatus ipParse (const char* S, size_t size, ipNumber& ipn, unsigned& field);
+  // ipS2ipN() without output: returns ipOK, or the kind of error and
+  // (in field) the number 1..4 of the field where it was found;
+  // uses SSSE3 when available, with a scalar fallback
+
+  static size_t   ipParseBulk (const char* const* S, const size_t* size, ipNumber* ipn,
+                               ipStatus* status, size_t n);
+  // ipParse() for n strings; returns the number converted
+
+  static bool     ipS2Prefix (const ipString& S, ipNumber& prefix, uint32_t& len);
+  // converts ipString with optional "/len" suffix to prefix and length
+  // (len = 32 when there is no suffix)
+  // return:  false in case of syntax error or bits set beyond len
 
-private: // one variable - this is an adaptor class
+private: // data - this is an adaptor class
 
   typedef fsu::Entry     < ipNumber, ipNumber >         EntryType;
-  typedef fsu::List      < EntryType >                  BucketType;
-  typedef fsu::HashTable < ipNumber, ipNumber, ipHash > TableType;
+  typedef fsu::HashChain < EntryType >                  BucketType;
+  typedef ipHash                                        HashType;
+  /* // integer hash functors with batch forms: ipMultHash, ipFmixHash, ipCrcHash
+  typedef ipFmixHash                                    HashType;
+  // */
+  // nodes from a per-table arena: Load fills it in order, Clear frees it at once
+  typedef fsu::HashTable < ipNumber, ipNumber, HashType, fsu::PrimeBuckets, fsu::NodeArena > TableType;
+  /* // open addressing table: one flat slot vector, no list nodes
+  typedef fsu::OHashTable < ipNumber, ipNumber, HashType > TableType;
+  // */
 
-  TableType * tablePtr_;
+  struct RouteVersion
+  {
+    TableType * tablePtr_;  // exact /32 destinations
+    RouteTrie * triePtr_;   // prefixes shorter than /32
+    DirTable  * dirPtr_;    // all routes, dirEngine only (0 otherwise)
+    uint64_t    generation_;  // changes with every update
+
+    RouteVersion  (uint32_t sizeEstimate, bool dir);
+    ~RouteVersion ();
+    void Clear    ();
+  } ;
+
+  struct Retired
+  {
+    RouteVersion * version_;
+    uint64_t       epoch_;
+  } ;
+
+  std::atomic < RouteVersion* > current_;
+  mutable EpochDomain           epochs_;
+  std::mutex                    updateMutex_; // one update at a time
+  std::vector < Retired >       retired_;     // awaiting reclamation
+  uint64_t                      generation_;  // of the latest version
+  uint32_t                      sizeEstimate_;
+  RouteEngine                   engine_;
+
+  unsigned    threads_;   // worker threads used by Go()
+  RouteStats  stats_;     // of the last Go()
+  LogFormat   format_;    // sink used by Go()
+  mutable std::vector < RouteCache > caches_; // one per Go() thread, or none
 
 private: // helper methods
 
-  // may add static or non-static helper methods here
+  static void Add      (RouteVersion& v, ipNumber dN, uint32_t len, ipNumber rN);
+  static void Drop     (RouteVersion& v, ipNumber dN, uint32_t len);
+  static void AddHosts (RouteVersion& v, const std::vector < EntryType >& hosts);
+  // store and remove a validated prefix in all lookup structures
+
+  static void LookupBatch (const RouteVersion& v, const ipNumber* dN, ipNumber* rN,
+                           uint8_t* found, size_t n);
+
+  RouteVersion* BeginUpdate (bool copy = 1);
+  void          EndUpdate   (RouteVersion* v);
+  // BeginUpdate returns the version to change: the current one when no
+  // reader is active, else a copy (or, if !copy, an empty version);
+  // EndUpdate publishes it and frees the versions no reader can see;
+  // Run frees those retired during a Go() once its readers have left
+  RouteVersion* Copy        (const RouteVersion& v) const;
+  void          Reclaim     (bool all);
+
+  template <class S>
+  void Run        (MsgReader& in, std::ostream& out);
+  template <class S>
+  void Route      (MsgReader& in, S& sink, RouteStats& stats, RouteCache* cache) const;
+  template <class S>
+  void RouteChunk (const char* begin, const char* end, std::string& log,
+                   RouteStats& stats, S& sink, RouteCache* cache) const;
+  template <class S>
+  void GoParallel (MsgReader& in, std::ostream& out, RouteStats& stats, S& sink) const;
+  // Go() with sink type S; the Go() loop, and its multi-threaded form
 
 } ; // class RouteTable
 
@@ -0,0 +1,251 @@
+/*
+    iptrie.cpp
+    contains RouteTrie implementations
+*/
+
+#include <iptrie.h>
+
+RouteTrie::Node::Node (ipNumber prefix, uint32_t len)
+  :  prefix_(prefix), route_(0), len_(len), hasRoute_(0)
+{
+  child_[0] = 0;
+  child_[1] = 0;
+}
+
+bool RouteTrie::Insert (ipNumber prefix, uint32_t len, ipNumber route)
+{
+  Node ** link = &root_;
+  Node *  n;
+  uint32_t common;
+
+  while (1)
+  {
+    n = *link;
+    if (n == 0)
+    {
+      n = NewNode(prefix, len);
+      n->route_ = route;
+      n->hasRoute_ = 1;
+      *link = n;
+      ++size_;
+      return 1;
+    }
+
+    common = Common(prefix, len, n->prefix_, n->len_);
+
+    if (common == n->len_)
+    {
+      if (len == n->len_) // prefix/len is this node
+      {
+        n->route_ = route;
+        if (n->hasRoute_)
+          return 0;
+        n->hasRoute_ = 1;
+        ++size_;
+        return 1;
+      }
+      // n is an ancestor of prefix/len
+      link = &n->child_[Bit(prefix, n->len_)];
+      continue;
+    }
+
+    if (common == len) // prefix/len is an ancestor of n
+    {
+      Node * m = NewNode(prefix, len);
+      m->route_ = route;
+      m->hasRoute_ = 1;
+      m->child_[Bit(n->prefix_, len)] = n;
+      *link = m;
+      ++size_;
+      return 1;
+    }
+
+    // prefix/len and n diverge at bit common - add a branch node
+    Node * b = NewNode(Mask(prefix, common), common);
+    Node * m = NewNode(prefix, len);
+    m->route_ = route;
+    m->hasRoute_ = 1;
+    b->child_[Bit(prefix, common)] = m;
+    b->child_[Bit(n->prefix_, common)] = n;
+    *link = b;
+    ++size_;
+    return 1;
+  }
+} // end RouteTrie::Insert()
+
+bool RouteTrie::Remove (ipNumber prefix, uint32_t len)
+{
+  Node ** link = &root_;
+  Node ** parentLink = 0;
+  Node *  n = root_;
+
+  while (n != 0)
+  {
+    if (n->len_ > len || Mask(prefix, n->len_) != n->prefix_)
+      return 0;
+    if (n->len_ == len)
+      break;
+    parentLink = link;
+    link = &n->child_[Bit(prefix, n->len_)];
+    n = *link;
+  }
+
+  if (n == 0 || !n->hasRoute_)
+    return 0;
+
+  n->hasRoute_ = 0;
+  n->route_ = 0;
+  --size_;
+
+  // a routeless node with two children is still needed as a branch
+  if (n->child_[0] != 0 && n->child_[1] != 0)
+    return 1;
+
+  *link = (n->child_[0] != 0) ? n->child_[0] : n->child_[1];
+  FreeNode(n);
+
+  // the parent may have been a branch node that is no longer needed
+  if (parentLink != 0)
+  {
+    Node * p = *parentLink;
+    if (!p->hasRoute_ && (p->child_[0] == 0 || p->child_[1] == 0))
+    {
+      *parentLink = (p->child_[0] != 0) ? p->child_[0] : p->child_[1];
+      FreeNode(p);
+    }
+  }
+  return 1;
+} // end RouteTrie::Remove()
+
+bool RouteTrie::Retrieve (ipNumber prefix, uint32_t len, ipNumber& route) const
+{
+  const Node * n = root_;
+  while (n != 0 && n->len_ <= len && Mask(prefix, n->len_) == n->prefix_)
+  {
+    if (n->len_ == len)
+    {
+      if (!n->hasRoute_)
+        return 0;
+      route = n->route_;
+      return 1;
+    }
+    n = n->child_[Bit(prefix, n->len_)];
+  }
+  return 0;
+}
+
+bool RouteTrie::Lookup (ipNumber address, ipNumber& route) const
+{
+  uint32_t len;
+  return Lookup(address, 32, route, len);
+}
+
+bool RouteTrie::Lookup (ipNumber address, uint32_t maxLen, ipNumber& route, uint32_t& len) const
+{
+  const Node * n = root_;
+  bool found = 0;
+  while (n != 0 && n->len_ <= maxLen && Mask(address, n->len_) == n->prefix_)
+  {
+    if (n->hasRoute_)
+    {
+      route = n->route_;
+      len = n->len_;
+      found = 1;
+    }
+    if (n->len_ == 32)
+      break;
+    n = n->child_[Bit(address, n->len_)];
+  }
+  return found;
+} // end RouteTrie::Lookup()
+
+void RouteTrie::Clear ()
+{
+  Release(root_);
+  root_ = 0;
+  size_ = 0;
+  nodes_ = 0;
+}
+
+size_t RouteTrie::Size () const
+{
+  return size_;
+}
+
+size_t RouteTrie::Nodes () const
+{
+  return nodes_;
+}
+
+bool RouteTrie::Empty () const
+{
+  return size_ == 0;
+}
+
+RouteTrie::RouteTrie () : root_(0), size_(0), nodes_(0)
+{}
+
+RouteTrie::~RouteTrie ()
+{
+  Clear();
+}
+
+ipNumber RouteTrie::Mask (ipNumber address, uint32_t len)
+{
+  if (len == 0)
+    return 0;
+  return address & (0xFFFFFFFFu << (32 - len));
+}
+
+// private helpers
+
+uint32_t RouteTrie::Bit (ipNumber address, uint32_t i)
+// bit i of address, numbered left to right beginning with 0
+{
+  return (address >> (31 - i)) & 1;
+}
+
+uint32_t RouteTrie::Common (ipNumber a, uint32_t alen, ipNumber b, uint32_t blen)
+// length of the common leading part of prefixes a/alen and b/blen
+{
+  uint32_t common = 0;
+  ipNumber diff = a ^ b;
+  if (diff == 0)
+    common = 32;
+  else
+  {
+#if defined(__GNUC__)
+    common = __builtin_clz(diff);
+#else
+    while ((diff & 0x80000000u) == 0)
+    {
+      diff <<= 1;
+      ++common;
+    }
+#endif
+  }
+  if (common > alen) common = alen;
+  if (common > blen) common = blen;
+  return common;
+}
+
+RouteTrie::Node * RouteTrie::NewNode (ipNumber prefix, uint32_t len)
+{
+  ++nodes_;
+  return new Node(prefix, len);
+}
+
+void RouteTrie::FreeNode (Node * n)
+{
+  --nodes_;
+  delete n;
+}
+
+void RouteTrie::Release (Node * n)
+{
+  if (n == 0)
+    return;
+  Release(n->child_[0]);
+  Release(n->child_[1]);
+  delete n;
+}
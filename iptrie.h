@@ -0,0 +1,114 @@
+/*
+    iptrie.h
+    contains RouteTrie class definition
+
+    Defining the RouteTrie class for longest-prefix-match lookup of
+    ip route addresses.
+
+    The trie stores (prefix/len, route) triples, where prefix is an
+    ipNumber whose bits beyond len are zero and len is in the range
+    0..32. A lookup of an address returns the route of the longest
+    stored prefix that matches the leading bits of the address.
+
+    The trie is binary (one address bit per level) and path compressed:
+    a node is only kept where a route is stored or where two subtries
+    branch, so the depth is bounded by the number of stored prefixes on
+    a path and never exceeds 33 nodes. Lookup cost is O(prefix bits).
+
+    Bits are numbered left to right beginning with 0, as in iptable.h.
+*/
+
+#ifndef _IPTRIE_H
+#define _IPTRIE_H
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <ipnum.h>
+
+class RouteTrie
+{
+public:
+
+  bool   Insert   (ipNumber prefix, uint32_t len, ipNumber route);
+  // pre:    len <= 32, prefix has no bits set beyond len
+  // post:   route is stored for prefix/len (replacing any previous route)
+  // return: true if prefix/len was not previously in the trie
+
+  bool   Remove   (ipNumber prefix, uint32_t len);
+  // return: true if prefix/len was found and removed
+
+  bool   Retrieve (ipNumber prefix, uint32_t len, ipNumber& route) const;
+  // exact match of prefix/len
+
+  bool   Lookup   (ipNumber address, ipNumber& route) const;
+  bool   Lookup   (ipNumber address, uint32_t maxLen, ipNumber& route, uint32_t& len) const;
+  // longest prefix match of address, considering only prefixes of
+  // length <= maxLen in the second form; len is set to the matched length
+
+  void   Clear    ();
+  size_t Size     () const;   // number of stored prefixes
+  size_t Nodes    () const;   // number of trie nodes (incl. branch nodes)
+  bool   Empty    () const;
+
+  template < class V >
+  void   Traverse (V& visitor) const;
+  // calls visitor(prefix, len, route) for each stored prefix,
+  // in address order with shorter prefixes before longer ones
+
+         RouteTrie  ();
+         ~RouteTrie ();
+
+  static ipNumber Mask (ipNumber address, uint32_t len);
+  // address with all bits beyond len cleared
+
+private:
+
+  struct Node
+  {
+    ipNumber  prefix_;
+    ipNumber  route_;
+    uint32_t  len_;
+    bool      hasRoute_;
+    Node *    child_[2];
+
+    Node (ipNumber prefix, uint32_t len);
+  } ;
+
+  Node *   root_;
+  size_t   size_;
+  size_t   nodes_;
+
+  static uint32_t Bit    (ipNumber address, uint32_t i);
+  static uint32_t Common (ipNumber a, uint32_t alen, ipNumber b, uint32_t blen);
+
+  Node *   NewNode  (ipNumber prefix, uint32_t len);
+  void     FreeNode (Node * n);
+  void     Release  (Node * n);
+
+  template < class V >
+  static void Traverse (const Node * n, V& visitor);
+
+  // prevent copying - do not implement
+  RouteTrie              (const RouteTrie&);
+  RouteTrie& operator =  (const RouteTrie&);
+} ;
+
+template < class V >
+void RouteTrie::Traverse (V& visitor) const
+{
+  Traverse(root_, visitor);
+}
+
+template < class V >
+void RouteTrie::Traverse (const Node * n, V& visitor)
+{
+  if (n == 0)
+    return;
+  if (n->hasRoute_)
+    visitor(n->prefix_, n->len_, n->route_);
+  Traverse(n->child_[0], visitor);
+  Traverse(n->child_[1], visitor);
+}
+
+#endif
@@ -0,0 +1,743 @@
+/*
+    ohashtbl.h
+
+    Defining the classes OHashTable <K, D, H>
+                     and OHashTable <K, D, H> :: Iterator
+
+    An open addressing alternative to HashTable <K, D, H> with the same
+    interface, so that either can be selected with a typedef.
+
+    K                    = KeyType
+    D                    = DataType
+    Entry < K , D >      = EntryType
+    H                    = HashType
+
+    Entries are stored directly in one flat vector of slots instead of
+    in a list per bucket, so a lookup touches the slot vector (usually a
+    single cache line) rather than chasing list nodes. Collisions are
+    resolved by linear probing with Robin Hood placement: a parallel
+    vector of 16-bit control words holds, for each slot, 0 if the slot is
+    empty or 1 + the distance of its entry from the entry's home slot. An
+    insert displaces any entry closer to its home than the entry being
+    placed, which keeps probe sequences short and lets an unsuccessful
+    search stop as soon as it meets an entry closer to home than itself.
+    Remove shifts the following entries back instead of leaving
+    tombstones.
+
+    The number of slots is a power of two and the home slot is taken
+    from the high bits of the hash multiplied by 2^64/phi, so the prime
+    argument of the constructors is accepted for compatibility but not
+    needed. The table grows by doubling whenever it is more than 7/8
+    full.
+
+    Entries are moved, not copied, when they are displaced, shifted back
+    by Remove, or carried to a new slot vector by Rehash, so a K or D
+    with move operations is not reallocated; otherwise moves are copies.
+
+    The return type of OHashTable<K, D, H>::Iterator::operator* is
+    const EntryType&. Iterators are invalidated by any Insert, Remove,
+    Get or Rehash.
+*/
+
+#ifndef _OHASHTBL_H
+#define _OHASHTBL_H
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <stdint.h>
+#include <utility> // std::move, std::swap
+
+#include <entry.h>
+#include <vector.h>
+#include <hashpolicy.h>
+
+namespace fsu
+{
+
+  template <typename K, typename D, class H>
+  class OHashTable;
+
+  template <typename K, typename D, class H>
+  class OHashTableIterator;
+
+  //--------------------------------------------
+  //     OHashTable <K,D,H>
+  //--------------------------------------------
+
+  template <typename K, typename D, class H>
+  class OHashTable
+  {
+    friend class OHashTableIterator <K,D,H>;
+  public:
+    typedef K                                KeyType;
+    typedef D                                DataType;
+    typedef fsu::Entry<K,D>                  EntryType;
+    typedef H                                HashType;
+    typedef EntryType                        ValueType;
+    typedef OHashTableIterator<K,D,H>        Iterator;
+    typedef OHashTableIterator<K,D,H>        ConstIterator;
+
+    // ADT Table
+    Iterator       Insert        (const K& k, const D& d);
+    bool           Remove        (const K& k);
+    bool           Retrieve      (const K& k, D& d) const;
+    Iterator       Includes      (const K& k) const;
+
+    // Retrieve for n keys at once, prefetching home slots (see hashtbl.h)
+    void           LookupBatch   (const K* keys, D* data, uint8_t* found, size_t n) const;
+
+    // ADT Associative Array
+    D&      Get        (const K& key);
+    void    Put        (const K& key, const D& data);
+    D&      operator[] (const K& key);
+
+    // Insert every Entry<K,D> in [first, last), growing the table once
+    // beforehand instead of as it fills (see hashtbl.h)
+    template <class I>
+    void           BulkLoad      (I first, I last, DuplicatePolicy policy = keepLast, bool presize = 1);
+
+    void           Clear         ();
+    void           Rehash        (size_t numBuckets = 0);
+    size_t         Size          () const;
+    bool           Empty         () const;
+    size_t         NumBuckets    () const;   // slots
+    size_t         BucketSize    (size_t b) const;   // entries whose home slot is b
+    size_t         Footprint     () const;   // bytes allocated
+
+    // Resizing is always on here: the table doubles once Size() exceeds
+    // maxLoad (at most 7/8, the default) of the slots, and halves once it
+    // falls below minLoad (default 0, no shrinking). See hashtbl.h.
+    void           SetLoadFactors (double maxLoad, double minLoad = 0);
+    double         LoadFactor    () const;
+    size_t         ResizeCount   () const;
+
+    ConstIterator  Begin         () const;
+    ConstIterator  End           () const;
+
+    // first ctor uses default hash object, second uses supplied hash object
+    explicit       OHashTable    (size_t numBuckets, bool prime = 1);
+    OHashTable    (size_t numBuckets, HashType hashObject, bool prime = 1);
+                   ~OHashTable   ();
+
+    // these are for debugging and analysis
+    size_t         MaxBucketSize () const;   // most entries sharing a home slot
+    void           Analysis      (std::ostream& os) const;
+    void           Dump          (std::ostream& os, int c1 = 0, int c2 = 0) const;
+    // Analysis: load factor, empty slots, probe distance histogram, and
+    // expected vs actual probes; O(slots) time, no allocation. The
+    // HASHTBL_PROBE_COUNT counters are HashTable only.
+
+  private:
+    typedef uint16_t       DistType;
+
+    // data
+    size_t                 numSlots_;  // power of 2
+    size_t                 shift_;     // 64 - log2(numSlots_)
+    size_t                 size_;
+    Vector < EntryType >   slotVector_;
+    Vector < DistType >    distVector_; // 0 = empty, else 1 + probe distance
+    HashType               hashObject_;
+    double                 maxLoad_;
+    double                 minLoad_;
+    size_t                 resizeCount_;
+
+    static const size_t    npos = ~(size_t)0;
+    static const DistType  maxDist = 0xFFFF;
+
+    // private methods
+    size_t  Home           (const KeyType& k) const;
+    size_t  HomeOf         (size_t hash) const;
+    size_t  Find           (const KeyType& k) const;
+    size_t  Find           (const KeyType& k, size_t home) const;
+    size_t  Place          (EntryType&& e);   // takes e's contents
+    void    Init           (size_t numSlots);
+    void    Grow           ();
+
+    // prevent copying - do not implement
+    OHashTable              (const OHashTable<K,D,H>&);
+    OHashTable& operator =  (const OHashTable&);
+  } ;
+
+  //--------------------------------------------
+  //     OHashTableIterator <K,D,H>
+  //--------------------------------------------
+
+  // Note: This is a ConstIterator - cannot be used to modify table
+
+  template <typename K, typename D, class H>
+  class OHashTableIterator
+  {
+    friend class OHashTable <K,D,H>;
+  public:
+    typedef K                                KeyType;
+    typedef D                                DataType;
+    typedef fsu::Entry<K,D>                  EntryType;
+    typedef H                                HashType;
+    typedef EntryType                        ValueType;
+    typedef OHashTableIterator<K,D,H>        Iterator;
+    typedef OHashTableIterator<K,D,H>        ConstIterator;
+
+    OHashTableIterator  ();
+    OHashTableIterator  (const Iterator& i);
+    bool Valid          () const;
+    OHashTableIterator <K,D,H>& operator =  (const Iterator& i);
+    OHashTableIterator <K,D,H>& operator ++ ();
+    OHashTableIterator <K,D,H>  operator ++ (int);
+    const Entry <K,D>&          operator *  () const;
+    bool                        operator == (const Iterator& i2) const;
+    bool                        operator != (const Iterator& i2) const;
+
+  protected:
+    const OHashTable <K,D,H> *  tablePtr_;
+    size_t                      slot_;
+  } ;
+
+  //--------------------------------------------
+  //     OHashTable <K,D,H>
+  //--------------------------------------------
+
+  // ADT Table
+
+  template <typename K, typename D, class H>
+  OHashTableIterator<K,D,H> OHashTable<K,D,H>::Insert (const K& k, const D& d)
+  {
+    OHashTableIterator<K,D,H> i;
+    i.tablePtr_ = this;
+    i.slot_ = Find(k);
+    if (i.slot_ != npos)
+      slotVector_[i.slot_].data_ = d;
+    else
+      i.slot_ = Place(EntryType(k, d));
+    return i;
+  }
+
+  template <typename K, typename D, class H>
+  bool OHashTable<K,D,H>::Remove (const K& k)
+  {
+    size_t i = Find(k);
+    if (i == npos)
+      return false;
+
+    // backward shift: pull each displaced follower one slot closer to home
+    size_t mask = numSlots_ - 1, j = (i + 1) & mask;
+    while (distVector_[j] > 1)
+    {
+      slotVector_[i] = std::move(slotVector_[j]);
+      distVector_[i] = distVector_[j] - 1;
+      i = j;
+      j = (j + 1) & mask;
+    }
+    slotVector_[i] = EntryType();
+    distVector_[i] = 0;
+    --size_;
+    if (size_ < minLoad_ * numSlots_ && numSlots_ > 8)
+    {
+      ++resizeCount_;
+      Rehash(numSlots_ / 2);
+    }
+    return true;
+  }
+
+  template <typename K, typename D, class H>
+  bool OHashTable<K,D,H>::Retrieve (const K& k, D& d) const
+  {
+    size_t i = Find(k);
+    if (i == npos)
+      return false;
+    d = slotVector_[i].data_;
+    return true;
+  }
+
+  template <typename K, typename D, class H>
+  OHashTableIterator<K,D,H> OHashTable<K,D,H>::Includes (const K& k) const
+  {
+    OHashTableIterator<K,D,H> i;
+    i.tablePtr_ = this;
+    i.slot_ = Find(k);
+    if (i.slot_ == npos)
+      i.slot_ = numSlots_;
+    return i;
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::LookupBatch (const K* keys, D* data, uint8_t* found, size_t n) const
+  {
+    const size_t groupSize = 16;
+    size_t home[groupSize], slot;
+
+    for (size_t base = 0; base < n; base += groupSize)
+    {
+      size_t m = (n - base < groupSize) ? n - base : groupSize;
+      HashBatch(hashObject_, keys + base, home, m);
+      for (size_t j = 0; j < m; ++j)
+      {
+        home[j] = HomeOf(home[j]);
+        FSU_PREFETCH(&distVector_[home[j]]);
+        FSU_PREFETCH(&slotVector_[home[j]]);
+      }
+      for (size_t j = 0; j < m; ++j)
+      {
+        slot = Find(keys[base + j], home[j]);
+        if (slot == npos)
+          found[base + j] = 0;
+        else
+        {
+          data[base + j] = slotVector_[slot].data_;
+          found[base + j] = 1;
+        }
+      }
+    }
+  }
+
+  // ADT Associative Array
+
+  template <typename K, typename D, class H>
+  D& OHashTable<K,D,H>::Get (const K& key)
+  {
+    size_t i = Find(key);
+    if (i == npos)
+      i = Place(EntryType(key));
+    return slotVector_[i].data_;
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::Put (const K& key, const D& data)
+  {
+    Get(key) = data;
+  }
+
+  template <typename K, typename D, class H>
+  D& OHashTable<K,D,H>::operator[] (const K& key)
+  {
+    return Get(key);
+  }
+
+  template <typename K, typename D, class H>
+  template <class I>
+  void OHashTable<K,D,H>::BulkLoad (I first, I last, DuplicatePolicy policy, bool presize)
+  {
+    size_t n = 0, slot;
+    I i;
+    for (i = first; i != last; ++i)
+      ++n;
+    n += size_;
+    if (presize && numSlots_ < n + n / 7)
+      Rehash(n + n / 7);
+    for (i = first; i != last; ++i)
+    {
+      slot = Find((*i).key_);
+      if (slot == npos)
+        Place(EntryType(*i));
+      else if (policy == keepLast)
+        slotVector_[slot].data_ = (*i).data_;
+    }
+  }
+
+  // constructors
+
+  template <typename K, typename D, class H>
+  OHashTable <K,D,H>::OHashTable (size_t n, bool)
+    :  numSlots_(0), shift_(0), size_(0), slotVector_(0), distVector_(0), hashObject_(),
+       maxLoad_(0.875), minLoad_(0), resizeCount_(0)
+  {
+    // room for n entries below the 7/8 growth threshold
+    Init(n + n / 7);
+  }
+
+  template <typename K, typename D, class H>
+  OHashTable <K,D,H>::OHashTable (size_t n, H hashObject, bool)
+    :  numSlots_(0), shift_(0), size_(0), slotVector_(0), distVector_(0), hashObject_(hashObject),
+       maxLoad_(0.875), minLoad_(0), resizeCount_(0)
+  {
+    Init(n + n / 7);
+  }
+
+  // other public methods
+
+  template <typename K, typename D, class H>
+  OHashTable <K,D,H>::~OHashTable ()
+  {
+    Clear();
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::Rehash (size_t nb)
+  {
+    if (nb < size_ + size_ / 7)
+      nb = size_ + size_ / 7;
+    Vector < EntryType > oldSlots(0);
+    Vector < DistType >  oldDist(0);
+    size_t oldNumSlots = numSlots_;
+    oldSlots.Swap(slotVector_);
+    oldDist.Swap(distVector_);
+    Init(nb);
+    for (size_t i = 0; i < oldNumSlots; ++i)
+      if (oldDist[i] != 0)
+        Place(std::move(oldSlots[i]));
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::Clear ()
+  {
+    for (size_t i = 0; i < numSlots_; ++i)
+    {
+      if (distVector_[i] != 0)
+      {
+        slotVector_[i] = EntryType();
+        distVector_[i] = 0;
+      }
+    }
+    size_ = 0;
+  }
+
+  template <typename K, typename D, class H>
+  OHashTableIterator<K,D,H> OHashTable<K,D,H>::Begin () const
+  {
+    OHashTableIterator<K,D,H> i;
+    i.tablePtr_ = this;
+    i.slot_ = 0;
+    while (i.slot_ < numSlots_ && distVector_[i.slot_] == 0)
+      ++i.slot_;
+    return i;
+  }
+
+  template <typename K, typename D, class H>
+  OHashTableIterator<K,D,H> OHashTable<K,D,H>::End () const
+  {
+    OHashTableIterator<K,D,H> i;
+    i.tablePtr_ = this;
+    i.slot_ = numSlots_;
+    return i;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable<K,D,H>::Size () const
+  {
+    return size_;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable<K,D,H>::NumBuckets () const
+  {
+    return numSlots_;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable<K,D,H>::BucketSize (size_t b) const
+  {
+    // Robin Hood keeps a cluster ordered by home slot, so the entries with
+    // home b follow any with earlier homes and stop at the first later one
+    size_t n = 0, mask = numSlots_ - 1, j = b;
+    for (size_t dist = 1; distVector_[j] >= dist; ++dist, j = (j + 1) & mask)
+      if (distVector_[j] == dist)
+        ++n;
+    return n;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable<K,D,H>::Footprint () const
+  {
+    return numSlots_ * (sizeof(EntryType) + sizeof(DistType));
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::SetLoadFactors (double maxLoad, double minLoad)
+  {
+    if (maxLoad <= 0 || maxLoad > 0.875)
+      maxLoad = 0.875;
+    if (minLoad > maxLoad / 2)
+      minLoad = maxLoad / 2;
+    maxLoad_ = maxLoad;
+    minLoad_ = minLoad;
+  }
+
+  template <typename K, typename D, class H>
+  double OHashTable<K,D,H>::LoadFactor () const
+  {
+    return (double)size_ / numSlots_;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable<K,D,H>::ResizeCount () const
+  {
+    return resizeCount_;
+  }
+
+  template <typename K, typename D, class H>
+  bool OHashTable<K,D,H>::Empty () const
+  {
+    return size_ == 0;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable<K,D,H>::MaxBucketSize () const
+  {
+    // entries with the same home are adjacent; start the scan at an empty
+    // slot so that no run wraps around the end
+    size_t mask = numSlots_ - 1, start = 0, max = 0, run = 0, home = 0, h, j, k;
+    while (start < numSlots_ && distVector_[start] != 0)
+      ++start;
+    for (k = 1; k <= numSlots_; ++k)
+    {
+      j = (start + k) & mask;
+      if (distVector_[j] == 0)
+      {
+        run = 0;
+        continue;
+      }
+      h = (j - distVector_[j] + 1) & mask;
+      run = (run > 0 && h == home) ? run + 1 : 1;
+      home = h;
+      if (run > max) max = run;
+    }
+    return max;
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::Analysis (std::ostream& os) const
+  {
+    const size_t histSize = 16;     // last entry counts distances this large or larger
+    size_t count[histSize] = { 0 };
+    size_t j, dist, empty = 0;
+    double probes = 0;
+    for (j = 0; j < numSlots_; ++j)
+    {
+      if (distVector_[j] == 0)
+      {
+        ++empty;
+        continue;
+      }
+      dist = distVector_[j] - 1;
+      ++count[dist < histSize ? dist : histSize - 1];
+      probes += distVector_[j];
+    }
+
+    // linear probing (Knuth): 1/2 (1 + 1/(1 - alpha)) probes to find a key
+    double alpha = (double)size_ / numSlots_;
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+    os << std::dec << std::fixed << std::setprecision(3)
+       << "  table size:              " << size_ << '\n'
+       << "  number of slots:         " << numSlots_ << '\n'
+       << "  load factor:             " << alpha << '\n'
+       << "  empty slots:             " << empty
+       << " (" << 100.0 * empty / numSlots_ << "%)\n"
+       << "  max bucket size:         " << MaxBucketSize() << '\n'
+       << "  probe distance histogram:\n";
+    for (dist = 0; dist < histSize; ++dist)
+      if (count[dist] > 0)
+        os << "    " << std::setw(6) << dist << (dist + 1 == histSize ? "+ " : "  ")
+           << std::setw(10) << count[dist] << '\n';
+    os << "  probes per search        expected   actual\n"
+       << "    key present:           " << std::setw(8) << 0.5 * (1 + 1 / (1 - alpha))
+       << std::setw(9) << (size_ ? probes / size_ : 0.0) << '\n';
+    os.flags(flags);
+    os.precision(precision);
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable<K,D,H>::Dump (std::ostream& os, int c1, int c2) const
+  {
+    for (size_t b = 0; b < numSlots_; ++b)
+    {
+      os << "b[" << b << "]:";
+      if (distVector_[b] != 0)
+        os << '\t' << std::setw(c1) << slotVector_[b].key_ << ':' << std::setw(c2) << slotVector_[b].data_;
+      os << '\n';
+    }
+  }
+
+  // private helpers
+
+  template <typename K, typename D, class H>
+  size_t OHashTable <K,D,H>::Home (const K& k) const
+  {
+    return HomeOf(hashObject_(k));
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable <K,D,H>::HomeOf (size_t h) const
+  {
+    // Fibonacci hashing: the high bits of h * 2^64/phi depend on all bits of h
+    return (size_t)(((uint64_t)h * 0x9E3779B97F4A7C15ull) >> shift_);
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable <K,D,H>::Find (const K& k) const
+  {
+    return Find(k, Home(k));
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable <K,D,H>::Find (const K& k, size_t home) const
+  {
+    size_t mask = numSlots_ - 1, i = home;
+    DistType dist = 1;
+    // stop at an empty slot or an entry closer to its home than we are to ours
+    while (distVector_[i] >= dist)
+    {
+      if (distVector_[i] == dist && slotVector_[i].key_ == k)
+        return i;
+      i = (i + 1) & mask;
+      ++dist;
+    }
+    return npos;
+  }
+
+  template <typename K, typename D, class H>
+  size_t OHashTable <K,D,H>::Place (EntryType&& e)
+  // pre:  e.key_ is not in the table
+  // returns the slot where e ends up
+  {
+    if (size_ + 1 > maxLoad_ * numSlots_)
+      Grow();
+
+    size_t  mask = numSlots_ - 1, i = Home(e.key_), placed = npos;
+    DistType dist = 1;
+    while (distVector_[i] != 0)
+    {
+      if (distVector_[i] < dist)
+      {
+        // rob the richer entry of its slot and carry it on
+        std::swap(slotVector_[i], e);
+        std::swap(distVector_[i], dist);
+        if (placed == npos)
+          placed = i;
+      }
+      i = (i + 1) & mask;
+      if (++dist == maxDist)
+      {
+        // probe distance no longer fits the control word: grow, then
+        // place the entry still being carried. In a sparse table growing
+        // cannot help - the hash gives too many keys the same value.
+        if (size_ < numSlots_ / 4)
+        {
+          std::cerr << "** OHashTable error: more than " << maxDist - 1
+                    << " keys share a probe sequence - hash function too weak\n";
+          exit (EXIT_FAILURE);
+        }
+        K key(placed == npos ? e.key_ : slotVector_[placed].key_);
+        Grow();
+        Place(std::move(e));
+        return Find(key);
+      }
+    }
+    slotVector_[i] = std::move(e);
+    distVector_[i] = dist;
+    ++size_;
+    return (placed == npos) ? i : placed;
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable <K,D,H>::Init (size_t n)
+  {
+    numSlots_ = 8;
+    shift_ = 61;
+    while (numSlots_ < n)
+    {
+      numSlots_ <<= 1;
+      --shift_;
+    }
+    size_ = 0;
+    slotVector_.SetSize(numSlots_);
+    distVector_.SetSize(numSlots_);
+    for (size_t i = 0; i < numSlots_; ++i)
+      distVector_[i] = 0;
+  }
+
+  template <typename K, typename D, class H>
+  void OHashTable <K,D,H>::Grow ()
+  {
+    ++resizeCount_;
+    Rehash(2 * numSlots_);
+  }
+
+  //--------------------------------------------
+  //     OHashTableIterator <K,D,H>
+  //--------------------------------------------
+
+  template <typename K, typename D, class H>
+  OHashTableIterator<K,D,H>::OHashTableIterator ()
+    :  tablePtr_(0), slot_(0)
+  {}
+
+  template <typename K, typename D, class H>
+  OHashTableIterator<K,D,H>::OHashTableIterator (const Iterator& i)
+    :  tablePtr_(i.tablePtr_), slot_(i.slot_)
+  {}
+
+  template <typename K, typename D, class H>
+  OHashTableIterator <K,D,H>& OHashTableIterator<K,D,H>::operator = (const Iterator& i)
+  {
+    if (this != &i)
+    {
+      tablePtr_ = i.tablePtr_;
+      slot_     = i.slot_;
+    }
+    return *this;
+  }
+
+  template <typename K, typename D, class H>
+  OHashTableIterator <K,D,H>& OHashTableIterator<K,D,H>::operator ++ ()
+  {
+    if (!Valid())
+      return *this;
+    ++slot_;
+    while (slot_ < tablePtr_->numSlots_ && tablePtr_->distVector_[slot_] == 0)
+      ++slot_;
+    return *this;
+  }
+
+  template <typename K, typename D, class H>
+  OHashTableIterator <K,D,H> OHashTableIterator<K,D,H>::operator ++ (int)
+  {
+    OHashTableIterator <K,D,H> i = *this;
+    operator ++();
+    return i;
+  }
+
+  template <typename K, typename D, class H>
+  const Entry<K,D>& OHashTableIterator<K,D,H>::operator * () const
+  {
+    if (!Valid())
+    {
+      std::cerr << "** OHashTableIterator error: invalid dereference\n";
+      exit (EXIT_FAILURE);
+    }
+    return tablePtr_->slotVector_[slot_];
+  }
+
+  template <typename K, typename D, class H>
+  bool OHashTableIterator<K,D,H>::operator == (const Iterator& i2) const
+  {
+    if (!Valid() && !i2.Valid())
+      return 1;
+    if (Valid() != i2.Valid())
+      return 0;
+
+    // now both are valid
+    if (tablePtr_ != i2.tablePtr_)
+      return 0;
+    return slot_ == i2.slot_;
+  }
+
+  template <typename K, typename D, class H>
+  bool OHashTableIterator<K,D,H>::operator != (const Iterator& i2) const
+  {
+    return !(*this == i2);
+  }
+
+  template <typename K, typename D, class H>
+  bool OHashTableIterator<K,D,H>::Valid () const
+  {
+    if (tablePtr_ == 0)
+      return 0;
+    if (slot_ >= tablePtr_->numSlots_)
+      return 0;
+    return tablePtr_->distVector_[slot_] != 0;
+  }
+
+} // namespace fsu
+
+#endif